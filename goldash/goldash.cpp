@@ -1,3 +1,19 @@
+#include "alloy.h"
+#include "balance.h"
+#include "calculation_log.h"
+#include "instrumentation.h"
+#include "io_worker.h"
+#include "log_aggregate.h"
+#include "metals.h"
+#include "parallel.h"
+#include "parsing.h"
+#include "paths.h"
+#include "price.h"
+#include "purity.h"
+#include "state.h"
+#include "units.h"
+#include "valuation.h"
+
 #include <iostream>
 #include <iomanip>
 #include <limits>
@@ -11,131 +27,761 @@
 #include <ctime>
 #include <vector>
 #include <map>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
+#include <shared_mutex>
+#include <csignal>
+#include <cerrno>
 
-// --- Unit Conversion Constants ---
-const double GRAMS_PER_TROY_OUNCE = 31.1034768;
-const double GRAMS_PER_OUNCE = 28.3495;
-const double GRAMS_PER_PENNYWEIGHT = 1.55517;
-const double GRAMS_PER_TOLA = 11.6638;
-const double GRAMS_PER_CARAT = 0.2;
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#endif
 
-// --- File Paths ---
-const std::string PRICE_FILENAME = "gold_price.dat";
-const std::string LOG_FILENAME = "calculation_log.csv";
-const std::string METALS_FILENAME = "metals.dat";
-const std::string CONFIG_FILENAME = "toolkit_config.dat";
+#ifdef __linux__
+#define GOLDASH_HAS_EPOLL 1
+#include <sys/epoll.h>
+#endif
 
-// --- Helper Functions ---
-void clearScreen() {
+// --- Terminal Output ---
+// Screens are drawn in-process: clearing is an ANSI escape sequence (virtual-terminal processing is
+// switched on for Windows consoles, with the console API as the fallback on consoles that lack
+// it), and a screen built in memory reaches the terminal in a single write, so redraws neither
+// start a shell nor flicker. Nothing is cleared when output is redirected.
+
+const char* const ANSI_CLEAR_SCREEN = "\x1b[H\x1b[2J\x1b[3J"; // home, clear screen, clear scrollback
+
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+
+enum class TerminalKind { Redirected, Ansi, LegacyConsole };
+
+TerminalKind terminalKind() {
+    static const TerminalKind kind = []() {
+#ifdef _WIN32
+        HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode;
+        if (console == INVALID_HANDLE_VALUE || !GetConsoleMode(console, &mode)) return TerminalKind::Redirected;
+        if ((mode & ENABLE_VIRTUAL_TERMINAL_PROCESSING) || SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING)) return TerminalKind::Ansi;
+        return TerminalKind::LegacyConsole;
+#else
+        return isatty(STDOUT_FILENO) ? TerminalKind::Ansi : TerminalKind::Redirected;
+#endif
+    }();
+    return kind;
+}
+
+// Writes bytes to stdout with one system call (looping only on a partial write), after anything
+// still buffered in std::cout.
+void writeToTerminal(const std::string& bytes) {
+    std::cout.flush();
+    const char* data = bytes.data();
+    size_t remaining = bytes.size();
+    while (remaining > 0) {
 #ifdef _WIN32
-    system("cls");
+        DWORD written = 0;
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(remaining, 1u << 30));
+        if (!WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), data, chunk, &written, nullptr) || written == 0) return;
 #else
-    system("clear");
+        ssize_t written = write(STDOUT_FILENO, data, remaining);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return;
+#endif
+        data += written;
+        remaining -= static_cast<size_t>(written);
+    }
+}
+
+#ifdef _WIN32
+void clearLegacyConsole() {
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (!GetConsoleScreenBufferInfo(console, &info)) return;
+    DWORD cells = static_cast<DWORD>(info.dwSize.X) * static_cast<DWORD>(info.dwSize.Y), written;
+    COORD origin = { 0, 0 };
+    FillConsoleOutputCharacterA(console, ' ', cells, origin, &written);
+    FillConsoleOutputAttribute(console, info.wAttributes, cells, origin, &written);
+    SetConsoleCursorPosition(console, origin);
+}
+#endif
+
+// Replaces whatever is on the terminal with screen.
+void presentScreen(const std::string& screen) {
+    switch (terminalKind()) {
+    case TerminalKind::Ansi:
+        writeToTerminal(ANSI_CLEAR_SCREEN + screen);
+        break;
+    case TerminalKind::LegacyConsole:
+#ifdef _WIN32
+        std::cout.flush();
+        clearLegacyConsole();
 #endif
+        writeToTerminal(screen);
+        break;
+    case TerminalKind::Redirected:
+        writeToTerminal(screen);
+        break;
+    }
 }
 
+void clearScreen() { presentScreen(std::string()); }
+
+// --- Helper Functions ---
+
 void clearInputBuffer() {
     std::cin.clear();
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 }
 
-// --- Class Definitions ---
+// --- HTTP Service ---
+// A small HTTP/1.1 server for the JSON endpoints. Every worker thread runs its own event loop
+// (epoll on Linux, poll/WSAPoll elsewhere) over the shared listening socket and the connections it
+// accepted, so a request is parsed, handled and answered on one thread without hand-offs.
+// Connections are kept alive and pipelined requests are answered in order. Each worker hands its
+// handler a monotonic arena that is reset after every request, so answering a request does not
+// touch the heap once the connection's buffers have grown to size.
+
+const size_t HTTP_MAX_HEADER_BYTES = 8 * 1024;
+const size_t HTTP_REQUEST_ARENA_BYTES = 16 * 1024; // requests needing more spill to the heap
+const size_t HTTP_MAX_BODY_BYTES = 64 * 1024;
+const int HTTP_POLL_INTERVAL_MS = 100; // how quickly workers notice stop()
+
+#ifdef _WIN32
+typedef SOCKET SocketHandle;
+const SocketHandle INVALID_SOCKET_HANDLE = INVALID_SOCKET;
+void closeSocket(SocketHandle socket) { closesocket(socket); }
+bool lastSocketErrorWouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+bool setNonBlocking(SocketHandle socket) {
+    u_long enabled = 1;
+    return ioctlsocket(socket, FIONBIO, &enabled) == 0;
+}
+#else
+typedef int SocketHandle;
+const SocketHandle INVALID_SOCKET_HANDLE = -1;
+void closeSocket(SocketHandle socket) { ::close(socket); }
+bool lastSocketErrorWouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+bool setNonBlocking(SocketHandle socket) {
+    int flags = fcntl(socket, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+#endif
+
+struct SocketEvent {
+    SocketHandle socket;
+    bool readable;
+    bool writable;
+    bool failed;
+};
 
-class Metal {
+// Level-triggered readiness for one worker's sockets.
+class SocketPoller {
 public:
-    std::string name;
-    double density; // g/cm^3
-    Metal(std::string n = "", double d = 0.0) : name(n), density(d) {}
+    SocketPoller() = default;
+    SocketPoller(const SocketPoller&) = delete;
+    SocketPoller& operator=(const SocketPoller&) = delete;
+
+#ifdef GOLDASH_HAS_EPOLL
+    ~SocketPoller() { if (epollFd >= 0) ::close(epollFd); }
+
+    bool open() {
+        epollFd = epoll_create1(0);
+        return epollFd >= 0;
+    }
+
+    // A shared socket (the listener) wakes only one of the workers waiting on it, where supported.
+    bool add(SocketHandle socket, bool shared) {
+        epoll_event event = {};
+        event.events = EPOLLIN;
+#ifdef EPOLLEXCLUSIVE
+        if (shared) event.events |= EPOLLEXCLUSIVE;
+#else
+        (void)shared;
+#endif
+        event.data.fd = socket;
+        return epoll_ctl(epollFd, EPOLL_CTL_ADD, socket, &event) == 0;
+    }
+
+    void watchWrites(SocketHandle socket, bool enabled) {
+        epoll_event event = {};
+        event.events = EPOLLIN | (enabled ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        event.data.fd = socket;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, socket, &event);
+    }
+
+    void remove(SocketHandle socket) { epoll_ctl(epollFd, EPOLL_CTL_DEL, socket, nullptr); }
+
+    void wait(int timeoutMs, std::vector<SocketEvent>& events) {
+        epoll_event ready[256];
+        int count = epoll_wait(epollFd, ready, 256, timeoutMs);
+        events.clear();
+        for (int i = 0; i < count; ++i) {
+            uint32_t flags = ready[i].events;
+            events.push_back({ ready[i].data.fd, (flags & EPOLLIN) != 0, (flags & EPOLLOUT) != 0, (flags & (EPOLLERR | EPOLLHUP)) != 0 });
+        }
+    }
+
+private:
+    int epollFd = -1;
+#else
+    bool open() { return true; }
+
+    bool add(SocketHandle socket, bool /*shared*/) {
+        PollEntry entry = {};
+        entry.fd = socket;
+        entry.events = POLLIN;
+        slots[socket] = entries.size();
+        entries.push_back(entry);
+        return true;
+    }
+
+    void watchWrites(SocketHandle socket, bool enabled) {
+        auto found = slots.find(socket);
+        if (found != slots.end()) entries[found->second].events = static_cast<short>(POLLIN | (enabled ? POLLOUT : 0));
+    }
+
+    void remove(SocketHandle socket) {
+        auto found = slots.find(socket);
+        if (found == slots.end()) return;
+        size_t slot = found->second;
+        slots.erase(found);
+        if (slot + 1 != entries.size()) {
+            entries[slot] = entries.back();
+            slots[entries[slot].fd] = slot;
+        }
+        entries.pop_back();
+    }
+
+    void wait(int timeoutMs, std::vector<SocketEvent>& events) {
+        events.clear();
+#ifdef _WIN32
+        int count = WSAPoll(entries.data(), static_cast<ULONG>(entries.size()), timeoutMs);
+#else
+        int count = poll(entries.data(), static_cast<nfds_t>(entries.size()), timeoutMs);
+#endif
+        if (count <= 0) return;
+        for (const PollEntry& entry : entries) {
+            if (entry.revents == 0) continue;
+            events.push_back({ entry.fd, (entry.revents & POLLIN) != 0, (entry.revents & POLLOUT) != 0,
+                (entry.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0 });
+        }
+    }
+
+private:
+#ifdef _WIN32
+    typedef WSAPOLLFD PollEntry;
+#else
+    typedef pollfd PollEntry;
+#endif
+    std::vector<PollEntry> entries;
+    std::unordered_map<SocketHandle, size_t> slots;
+#endif
 };
 
-class Settings {
+// Members of a flat JSON object such as {"impurity":"Silver","weightInAir":10.5}. Nested values
+// are rejected; the endpoints only take scalars. Members are allocated from the given resource,
+// normally the request arena.
+class JsonFields {
 public:
-    std::string currencySymbol;
-    int defaultWeightUnit;
+    explicit JsonFields(std::pmr::memory_resource* memory = std::pmr::get_default_resource()) : members(memory) {}
+
+    bool parse(const std::string& text) {
+        members.clear();
+        size_t i = skipSpace(text, 0);
+        if (i >= text.size() || text[i] != '{') return false;
+        i = skipSpace(text, i + 1);
+        if (i < text.size() && text[i] == '}') return skipSpace(text, i + 1) == text.size();
+        for (;;) {
+            Member member{ std::pmr::string(members.get_allocator()), std::pmr::string(members.get_allocator()) };
+            if (!parseString(text, i, member.key)) return false;
+            i = skipSpace(text, i);
+            if (i >= text.size() || text[i] != ':') return false;
+            i = skipSpace(text, i + 1);
+            if (i < text.size() && text[i] == '"') {
+                member.isString = true;
+                if (!parseString(text, i, member.value)) return false;
+            }
+            else {
+                size_t start = i;
+                while (i < text.size() && (std::isalnum(static_cast<unsigned char>(text[i])) || text[i] == '-' || text[i] == '+' || text[i] == '.')) ++i;
+                if (i == start) return false;
+                member.value.assign(text, start, i - start);
+            }
+            members.push_back(std::move(member));
+
+            i = skipSpace(text, i);
+            if (i < text.size() && text[i] == ',') { i = skipSpace(text, i + 1); continue; }
+            return i < text.size() && text[i] == '}' && skipSpace(text, i + 1) == text.size();
+        }
+    }
+
+    bool has(const char* key) const { return find(key) != nullptr; }
+
+    std::pmr::memory_resource* memory() const { return members.get_allocator().resource(); }
 
-    Settings() : currencySymbol(""), defaultWeightUnit(1) {} // Default to grams
+    bool getNumber(const char* key, double& value) const {
+        const Member* member = find(key);
+        return member != nullptr && !member->isString && parseDouble(member->value.c_str(), member->value.size(), value) && std::isfinite(value);
+    }
+
+    // Into a std::string, or a std::pmr::string on memory() to keep the request free of heap allocations.
+    template <typename String>
+    bool getString(const char* key, String& value) const {
+        const Member* member = find(key);
+        if (member == nullptr || !member->isString) return false;
+        value.assign(member->value.data(), member->value.size());
+        return true;
+    }
 
-    void load() {
-        std::ifstream configFile(CONFIG_FILENAME);
-        if (configFile.is_open()) {
-            std::string line;
-            if (std::getline(configFile, line)) currencySymbol = line;
-            if (std::getline(configFile, line)) defaultWeightUnit = std::stoi(line);
+private:
+    struct Member {
+        std::pmr::string key;
+        std::pmr::string value;
+        bool isString = false;
+    };
+    std::pmr::vector<Member> members;
+
+    const Member* find(const char* key) const {
+        for (const Member& member : members) {
+            if (member.key == key) return &member;
         }
+        return nullptr;
+    }
+
+    static size_t skipSpace(const std::string& text, size_t i) {
+        while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i]))) ++i;
+        return i;
     }
 
-    void save() {
-        std::ofstream configFile(CONFIG_FILENAME);
-        if (configFile.is_open()) {
-            configFile << currencySymbol << "\n";
-            configFile << defaultWeightUnit << "\n";
+    // Reads the string starting at text[i] == '"' and leaves i after the closing quote.
+    static bool parseString(const std::string& text, size_t& i, std::pmr::string& value) {
+        if (i >= text.size() || text[i] != '"') return false;
+        value.clear();
+        for (++i; i < text.size(); ++i) {
+            char c = text[i];
+            if (c == '"') { ++i; return true; }
+            if (c != '\\') { value += c; continue; }
+            if (++i >= text.size()) return false;
+            switch (text[i]) {
+            case '"': case '\\': case '/': value += text[i]; break;
+            case 'n': value += '\n'; break;
+            case 't': value += '\t'; break;
+            default: return false; // \uXXXX and friends are not needed by any endpoint
+            }
         }
+        return false;
     }
 };
 
-class GoldItem {
+// Builds one flat JSON object into a response body.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& target) : out(target) { out += '{'; }
+
+    JsonWriter& number(const char* key, double value) {
+        char text[32];
+        int length = std::snprintf(text, sizeof(text), "%.10g", std::isfinite(value) ? value : 0.0);
+        writeKey(key);
+        out.append(text, static_cast<size_t>(length));
+        return *this;
+    }
+
+    JsonWriter& boolean(const char* key, bool value) {
+        writeKey(key);
+        out += value ? "true" : "false";
+        return *this;
+    }
+
+    template <typename String> // std::string or std::pmr::string
+    JsonWriter& string(const char* key, const String& value) {
+        writeKey(key);
+        out += '"';
+        for (char c : value) {
+            if (c == '"' || c == '\\') out += '\\';
+            if (static_cast<unsigned char>(c) < 0x20) continue;
+            out += c;
+        }
+        out += '"';
+        return *this;
+    }
+
+    void close() { out += '}'; }
+
 private:
-    double totalMassGrams;
-    double density;
-    Metal impurity;
+    std::string& out;
+    bool first = true;
+
+    void writeKey(const char* key) {
+        if (!first) out += ',';
+        first = false;
+        out += '"';
+        out += key;
+        out += "\":";
+    }
+};
+
+struct HttpRequest {
+    std::string method;
+    std::string path; // without the query string
+    std::string body;
+    std::pmr::memory_resource* arena = std::pmr::get_default_resource(); // scratch for the handler, reset after the response
+};
+
+struct HttpResponse {
+    int status = 200;
+    const char* contentType = "application/json";
+    std::string body;
+};
+
+void setHttpError(HttpResponse& response, int status, const std::string& message) {
+    response.status = status;
+    response.contentType = "application/json";
+    response.body.clear();
+    JsonWriter(response.body).string("error", message).close();
+}
 
+class HttpServer {
 public:
-    GoldItem() : totalMassGrams(0), density(0) {}
+    typedef std::function<void(const HttpRequest&, HttpResponse&)> Handler;
 
-    void setImpurity(const Metal& imp) { impurity = imp; }
-    void setTotalMass(double mass) { totalMassGrams = mass; }
-    void setDensity(double d) { density = d; }
+    // The handler is called concurrently from every worker thread.
+    explicit HttpServer(Handler requestHandler) : handler(std::move(requestHandler)) {}
+    ~HttpServer() { stop(); }
 
-    void calculateDensityFromWeight(double weightInAirGrams, double weightInWaterGrams) {
-        if (weightInAirGrams > weightInWaterGrams && weightInWaterGrams > 0) {
-            density = weightInAirGrams / (weightInAirGrams - weightInWaterGrams);
-            totalMassGrams = weightInAirGrams;
+    bool start(uint16_t port, size_t workerCount) {
+#ifdef _WIN32
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) return false;
+#else
+        std::signal(SIGPIPE, SIG_IGN); // a client hanging up mid-response must not end the process
+#endif
+        listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listener == INVALID_SOCKET_HANDLE) return false;
+#ifndef _WIN32
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+            || listen(listener, SOMAXCONN) != 0 || !setNonBlocking(listener)) {
+            closeSocket(listener);
+            listener = INVALID_SOCKET_HANDLE;
+            return false;
         }
-        else {
-            density = 0;
+
+        running = true;
+        for (size_t i = 0; i < std::max<size_t>(1, workerCount); ++i) workers.emplace_back(&HttpServer::workerLoop, this);
+        return true;
+    }
+
+    void stop() {
+        if (listener == INVALID_SOCKET_HANDLE) return;
+        running = false;
+        for (std::thread& worker : workers) worker.join();
+        workers.clear();
+        closeSocket(listener);
+        listener = INVALID_SOCKET_HANDLE;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+private:
+    struct Connection {
+        std::string input;
+        std::string output;
+        size_t sent = 0;
+        bool watchingWrites = false;
+        bool closeAfterWrite = false;
+    };
+
+    Handler handler;
+    SocketHandle listener = INVALID_SOCKET_HANDLE;
+    std::atomic<bool> running{ false };
+    std::vector<std::thread> workers;
+
+    void workerLoop() {
+        SocketPoller poller;
+        if (!poller.open() || !poller.add(listener, true)) return;
+        std::unordered_map<SocketHandle, Connection> connections;
+        std::vector<SocketEvent> events;
+        HttpRequest request;
+        HttpResponse response;
+        char buffer[16 * 1024];
+        alignas(std::max_align_t) char arenaBuffer[HTTP_REQUEST_ARENA_BYTES];
+        std::pmr::monotonic_buffer_resource arena(arenaBuffer, sizeof(arenaBuffer));
+        request.arena = &arena;
+
+        auto closeConnection = [&](SocketHandle socket) {
+            poller.remove(socket);
+            closeSocket(socket);
+            connections.erase(socket);
+        };
+
+        while (running.load(std::memory_order_relaxed)) {
+            poller.wait(HTTP_POLL_INTERVAL_MS, events);
+            for (const SocketEvent& event : events) {
+                if (event.socket == listener) {
+                    acceptConnections(poller, connections);
+                    continue;
+                }
+                auto found = connections.find(event.socket);
+                if (found == connections.end()) continue;
+                Connection& connection = found->second;
+                if (event.failed) {
+                    closeConnection(event.socket);
+                    continue;
+                }
+
+                if (event.readable) {
+                    int received;
+                    while ((received = static_cast<int>(recv(event.socket, buffer, sizeof(buffer), 0))) > 0) {
+                        connection.input.append(buffer, static_cast<size_t>(received));
+                        if (static_cast<size_t>(received) < sizeof(buffer)) break;
+                    }
+                    if (received == 0 || (received < 0 && !lastSocketErrorWouldBlock())) {
+                        closeConnection(event.socket);
+                        continue;
+                    }
+                    processInput(connection, request, response, arena);
+                }
+                if ((!connection.output.empty() || connection.closeAfterWrite) && !flush(event.socket, connection, poller)) {
+                    closeConnection(event.socket);
+                }
+            }
+        }
+        for (auto& entry : connections) closeSocket(entry.first);
+    }
+
+    void acceptConnections(SocketPoller& poller, std::unordered_map<SocketHandle, Connection>& connections) {
+        for (;;) {
+            SocketHandle client = accept(listener, nullptr, nullptr);
+            if (client == INVALID_SOCKET_HANDLE) return; // drained, or another worker got it first
+            int noDelay = 1;
+            setsockopt(client, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+            if (!setNonBlocking(client) || !poller.add(client, false)) {
+                closeSocket(client);
+                continue;
+            }
+            connections[client];
+        }
+    }
+
+    // Sends as much queued output as the socket takes. Returns false once the connection should close.
+    bool flush(SocketHandle socket, Connection& connection, SocketPoller& poller) {
+        while (connection.sent < connection.output.size()) {
+            int sent = static_cast<int>(send(socket, connection.output.data() + connection.sent,
+                static_cast<int>(connection.output.size() - connection.sent), 0));
+            if (sent <= 0) {
+                if (sent < 0 && lastSocketErrorWouldBlock()) {
+                    if (!connection.watchingWrites) poller.watchWrites(socket, true);
+                    connection.watchingWrites = true;
+                    return true;
+                }
+                return false;
+            }
+            connection.sent += static_cast<size_t>(sent);
         }
+        connection.output.clear();
+        connection.sent = 0;
+        if (connection.watchingWrites) poller.watchWrites(socket, false);
+        connection.watchingWrites = false;
+        return !connection.closeAfterWrite;
     }
 
-    bool isDensityValid() const {
-        if (density <= 0 || impurity.name.empty()) return false;
-        double lowerBound = std::min(19.32, impurity.density);
-        double upperBound = std::max(19.32, impurity.density);
-        return (density >= lowerBound - 0.05 && density <= upperBound + 0.05);
+    // Answers every complete request in the input buffer.
+    void processInput(Connection& connection, HttpRequest& request, HttpResponse& response, std::pmr::monotonic_buffer_resource& arena) {
+        const std::string& input = connection.input;
+        size_t offset = 0;
+        while (!connection.closeAfterWrite) {
+            size_t headerEnd = input.find("\r\n\r\n", offset);
+            if (headerEnd == std::string::npos) {
+                if (input.size() - offset > HTTP_MAX_HEADER_BYTES) fail(connection, response, 431, "request headers too large");
+                break;
+            }
+
+            size_t lineEnd = input.find("\r\n", offset);
+            size_t methodEnd = input.find(' ', offset);
+            size_t targetEnd = methodEnd < lineEnd ? input.find(' ', methodEnd + 1) : std::string::npos;
+            if (targetEnd == std::string::npos || targetEnd > lineEnd) {
+                fail(connection, response, 400, "malformed request line");
+                break;
+            }
+            request.method.assign(input, offset, methodEnd - offset);
+            size_t pathEnd = std::min(targetEnd, input.find('?', methodEnd + 1));
+            request.path.assign(input, methodEnd + 1, pathEnd - methodEnd - 1);
+            bool keepAlive = input.compare(targetEnd + 1, lineEnd - targetEnd - 1, "HTTP/1.1") == 0;
+
+            size_t contentLength = 0;
+            bool chunked = false;
+            for (size_t line = lineEnd + 2; line < headerEnd;) {
+                size_t end = input.find("\r\n", line);
+                size_t colon = input.find(':', line);
+                if (colon < end) {
+                    size_t valueStart = colon + 1;
+                    while (valueStart < end && input[valueStart] == ' ') ++valueStart;
+                    if (equalsLowercase(input, line, colon, "content-length")) {
+                        contentLength = static_cast<size_t>(std::strtoull(input.c_str() + valueStart, nullptr, 10));
+                    }
+                    else if (equalsLowercase(input, line, colon, "transfer-encoding")) {
+                        chunked = !equalsLowercase(input, valueStart, end, "identity");
+                    }
+                    else if (equalsLowercase(input, line, colon, "connection")) {
+                        keepAlive = equalsLowercase(input, valueStart, end, "keep-alive") || (keepAlive && !equalsLowercase(input, valueStart, end, "close"));
+                    }
+                }
+                line = end + 2;
+            }
+            if (chunked) {
+                fail(connection, response, 501, "chunked request bodies are not supported");
+                break;
+            }
+            if (contentLength > HTTP_MAX_BODY_BYTES) {
+                fail(connection, response, 413, "request body too large");
+                break;
+            }
+            size_t bodyStart = headerEnd + 4;
+            if (input.size() - bodyStart < contentLength) break; // wait for the rest of the body
+            request.body.assign(input, bodyStart, contentLength);
+
+            response.status = 200;
+            response.contentType = "application/json";
+            response.body.clear();
+            handler(request, response);
+            arena.release();
+            appendResponse(connection.output, response, keepAlive);
+            connection.closeAfterWrite = !keepAlive;
+            offset = bodyStart + contentLength;
+        }
+        connection.input.erase(0, connection.closeAfterWrite ? connection.input.size() : offset);
     }
 
-    double getPureGoldMass() const {
-        if (!isDensityValid() || totalMassGrams <= 0) return 0.0;
-        if (std::abs(density - 19.32) < 0.05) return totalMassGrams;
-        double objectVolume = totalMassGrams / density;
-        double volumeFractionGold = (density - impurity.density) / (19.32 - impurity.density);
-        return (volumeFractionGold * objectVolume) * 19.32;
+    // Case-insensitive comparison of text[begin, end) with a lowercase literal, without copying.
+    static bool equalsLowercase(const std::string& text, size_t begin, size_t end, const char* lowercase) {
+        for (size_t i = begin; i < end; ++i, ++lowercase) {
+            if (*lowercase == '\0' || std::tolower(static_cast<unsigned char>(text[i])) != *lowercase) return false;
+        }
+        return *lowercase == '\0';
     }
 
-    double getPurityPercentage() const {
-        double pureGoldMass = getPureGoldMass();
-        if (totalMassGrams <= 0 || pureGoldMass <= 0) return 0.0;
-        return (pureGoldMass / totalMassGrams) * 100.0;
+    void fail(Connection& connection, HttpResponse& response, int status, const char* message) {
+        setHttpError(response, status, message);
+        appendResponse(connection.output, response, false);
+        connection.closeAfterWrite = true;
     }
 
-    double getKarats() const { return getPurityPercentage() * (24.0 / 100.0); }
-    double getDensity() const { return density; }
+    static const char* statusText(int status) {
+        switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 501: return "Not Implemented";
+        default: return "Internal Server Error";
+        }
+    }
+
+    static void appendResponse(std::string& out, const HttpResponse& response, bool keepAlive) {
+        char header[192];
+        int length = std::snprintf(header, sizeof(header),
+            "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n%s\r\n",
+            response.status, statusText(response.status), response.contentType, response.body.size(), keepAlive ? "" : "Connection: close\r\n");
+        out.append(header, static_cast<size_t>(length));
+        out += response.body;
+    }
 };
 
+// Set from the SIGINT handler while App::serve() runs.
+std::atomic<bool> serviceStopRequested(false);
+extern "C" void requestServiceStop(int) { serviceStopRequested = true; }
+
 class App {
 private:
-    double goldPricePerGram;
-    std::vector<Metal> metals;
+    PriceCell goldPrice;
+    MetalRegistry& metals = metalRegistry();
     Settings settings;
+    PriceHistory priceHistory;    // loaded on first use, see history()
+    bool priceHistoryLoaded = false;
+    std::mutex priceHistoryMutex; // the feed and I/O threads append ticks and compact the journal while the UI reads history
+    LogWriter logWriter;
+    std::unique_ptr<PriceFeed> priceFeed;
+    std::shared_mutex metalsMutex; // service workers read the registry shared; every change after startup takes it exclusively
+    LatencySnapshot instrumentationBaseline; // the instrumentation view shows samples since this
+    AssayCacheStats assayCacheBaseline;      // and cache counts since this
+    BalanceHub balances;                     // serial balances given with --balance, read on their own thread
+    IoWorker io;                             // saves, off the UI thread; declared last so it finishes before the rest goes
 
 public:
-    App() : goldPricePerGram(0.0) {
-        settings.load();
-        loadMetals();
-        if (metals.empty()) initializeDefaultMetals();
-        loadGoldPrice();
+    App() : logWriter(LOG_FILENAME, BINARY_LOG_FILENAME) {
+        if (!loadState()) {
+            settings.load();
+            loadMetals();
+            if (metals.empty()) initializeDefaultMetals();
+            loadGoldPrice();
+            saveState();
+        }
         initializeLogFile();
     }
 
+    ~App() {
+        if (priceFeed) {
+            priceFeed->stop();
+            saveState(); // fold the feed's journaled ticks into the state file
+        }
+        if (io.pending() > 0) std::cerr << "Finishing " << io.pending() << " background save(s)...\n";
+        io.stop();
+    }
+
+    // Follows prices written to feedPath on a background thread and records each tick in the history.
+    void startPriceFeed(const std::string& feedPath) {
+        std::string currency = settings.currencySymbol; // copied: settings belong to the UI thread
+        priceFeed.reset(new PriceFeed(feedPath, goldPrice, [this, currency](double price, int64_t timestamp) {
+            std::lock_guard<std::mutex> lock(priceHistoryMutex);
+            history().append(timestamp, price, currency);
+            appendPriceJournal(STATE_JOURNAL_FILENAME, price, timestamp);
+        }));
+        priceFeed->start();
+    }
+
+    // Connects a balance given as PORT or PORT:BAUD. A port that cannot be opened is reported and the
+    // purity calculators fall back to typed weights.
+    void addBalance(const std::string& spec) {
+        std::string port = spec;
+        int baud = BALANCE_DEFAULT_BAUD;
+        size_t colon = spec.rfind(':');
+        if (colon != std::string::npos && colon + 1 < spec.size()
+            && std::all_of(spec.begin() + static_cast<std::ptrdiff_t>(colon) + 1, spec.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; })) {
+            port = spec.substr(0, colon);
+            baud = std::atoi(spec.c_str() + colon + 1);
+        }
+        std::string error;
+        if (!balances.addPort(port, baud, error)) std::cerr << "Balance " << spec << ": " << error << "\n";
+    }
+
+    void startBalances() { balances.start(); }
+
     void run() {
         int choice;
         do {
@@ -149,45 +795,319 @@ public:
                 clearInputBuffer();
                 choice = 0;
             }
-            if (choice != 10) {
+            if (choice != 11) {
                 std::cout << "\nPress Enter to return to the main menu...";
                 clearInputBuffer();
                 std::cin.get();
             }
-        } while (choice != 10);
+        } while (choice != 11);
+    }
+
+    // Headless assay mode: reads "impurity,weightInAir,weightInWater,stoneCarats" records (weights in
+    // the given unit, stone weight optional; the impurity may be a blend such as "Silver:3+Copper:1")
+    // and writes one result row per record. Records are looked up in the assay cache first and the
+    // rest assayed in fixed-size blocks through computePurityBulk, so memory use does not grow with
+    // the input. Returns the number of rejected records.
+    size_t runBatch(std::istream& in, std::ostream& out, int weightUnit = 1) {
+        return withMassUnit(weightUnit, [&](auto unit) { return runBatchIn<decltype(unit)>(in, out); });
+    }
+
+    template <typename Unit>
+    size_t runBatchIn(std::istream& in, std::ostream& out) {
+        const size_t BLOCK_SIZE = 1024;
+        double pricePerGram = goldPricePerGram();
+        out << "Impurity,WeightInAir(" << Unit::SYMBOL << "),WeightInWater(" << Unit::SYMBOL << "),StoneWeight(ct),Density,Purity(%),Karat,PureGold("
+            << Unit::SYMBOL << "),MarketValue\n";
+        out << std::fixed;
+
+        struct BatchRecord { MetalId impurity; double weightInAir, weightInWater, stoneCarats; bool cached; PurityResult result; };
+        std::vector<BatchRecord> records;
+        records.reserve(BLOCK_SIZE);
+        AssayBatch batch;
+        batch.reserve(BLOCK_SIZE);
+
+        auto flushBlock = [&]() {
+            batch.compute();
+            size_t computed = 0; // the batch holds only the records that missed the cache
+            for (BatchRecord& record : records) {
+                if (!record.cached) {
+                    record.result = { batch.density[computed], batch.purityPercent[computed], batch.karats[computed], batch.pureGoldGrams[computed] };
+                    storeCachedAssay(batch.massGrams[computed], batch.density[computed], batch.impurityDensity[computed], record.result);
+                    ++computed;
+                }
+                const PurityResult& result = record.result;
+                out << metals.get(record.impurity).name << ','
+                    << std::setprecision(4) << record.weightInAir << ',' << record.weightInWater << ',' << record.stoneCarats << ','
+                    << result.density << ',' << result.purityPercent << ',' << result.karats << ','
+                    << Mass<Unit>(Mass<Grams>(result.pureGoldGrams)).value() << ','
+                    << std::setprecision(2) << result.pureGoldGrams * pricePerGram << '\n';
+            }
+            records.clear();
+            batch.clear();
+        };
+
+        std::string line;
+        std::string fields[4];
+        size_t lineNumber = 0, rejected = 0;
+        while (std::getline(in, line)) {
+            ++lineNumber;
+            size_t count = splitCsvLine(line, fields, 4);
+            if (count == 0 || fields[0].empty() || fields[0][0] == '#') continue;
+
+            double weightInAir, weightInWater, stoneCarats = 0.0;
+            if (count < 3 || !parseDouble(fields[1], weightInAir) || !parseDouble(fields[2], weightInWater)
+                || (count > 3 && !fields[3].empty() && !parseDouble(fields[3], stoneCarats))
+                || !std::isfinite(weightInAir) || !std::isfinite(weightInWater) || !std::isfinite(stoneCarats)) { // strtod takes "nan" and "inf"
+                if (lineNumber == 1) continue; // header row
+                std::cerr << "Line " << lineNumber << ": malformed record, skipped.\n";
+                ++rejected;
+                continue;
+            }
+
+            MetalId impurity;
+            {
+                std::unique_lock<std::shared_mutex> lock(metalsMutex); // may register a blend
+                impurity = resolveImpurity(metals, fields[0]);
+            }
+            if (impurity == INVALID_METAL_ID) {
+                std::cerr << "Line " << lineNumber << ": unknown impurity '" << fields[0] << "', skipped.\n";
+                ++rejected;
+                continue;
+            }
+
+            Mass<Grams> stoneWeight = Mass<Carats>(stoneCarats);
+            Mass<Grams> metalInAir = Mass<Grams>(Mass<Unit>(weightInAir)) - stoneWeight;
+            Mass<Grams> metalInWater = Mass<Grams>(Mass<Unit>(weightInWater)) - stoneWeight;
+            if (metalInAir.value() <= 0) {
+                std::cerr << "Line " << lineNumber << ": metal weight is zero or negative after stone deduction, skipped.\n";
+                ++rejected;
+                continue;
+            }
+
+            GoldItem item;
+            item.calculateDensityFromWeight(metalInAir.value(), metalInWater.value());
+            double impurityDensity = metals.get(impurity).density;
+            BatchRecord record = { impurity, weightInAir, weightInWater, stoneCarats, false, {} };
+            record.cached = findCachedAssay(metalInAir.value(), item.getDensity(), impurityDensity, record.result);
+            if (!record.cached) {
+                batch.add(metalInAir, item.getDensity(), impurityDensity);
+            }
+            records.push_back(record);
+            if (records.size() == BLOCK_SIZE) flushBlock();
+        }
+        if (!records.empty()) flushBlock();
+        out.flush();
+        return rejected;
+    }
+
+    // Serves the calculators as JSON over HTTP until Ctrl+C. Endpoints (POST bodies are flat JSON
+    // objects; masses are in grams unless "unit" is one of g, ozt, oz, dwt, tola):
+    //   POST /purity/weight   {impurity, weightInAir, weightInWater, [stoneCarats]}
+    //   POST /purity/density  {impurity, density, mass, [stoneCarats]}
+    //   POST /alloy           {mass, karat, targetKarat, [fineGoldKarat]}
+    //   POST /valuation       {mass, karat}
+    //   GET  /price
+    //   GET  /metrics         operation latencies in the Prometheus text format
+    //   GET  /summary         today's and this month's calculation log totals
+    // Service requests are not written to the calculation log.
+    int serve(uint16_t port, size_t workerCount) {
+        HttpServer server([this](const HttpRequest& request, HttpResponse& response) { handleServiceRequest(request, response); });
+        if (!server.start(port, workerCount)) {
+            std::cerr << "Cannot listen on port " << port << ".\n";
+            return 1;
+        }
+        std::cout << "Serving on port " << port << " with " << workerCount << " worker(s). Press Ctrl+C to stop.\n";
+        serviceStopRequested = false;
+        std::signal(SIGINT, requestServiceStop);
+        while (!serviceStopRequested) std::this_thread::sleep_for(std::chrono::milliseconds(HTTP_POLL_INTERVAL_MS));
+        server.stop();
+        std::cout << "Service stopped.\n";
+        return 0;
     }
 
 private:
-    void displayDateTime() {
+    void handleServiceRequest(const HttpRequest& request, HttpResponse& response) {
+        if (request.path == "/metrics") {
+            if (request.method != "GET") { setHttpError(response, 405, "use GET"); return; }
+            std::ostringstream metrics;
+            writePrometheusMetrics(metrics, snapshotLatencies());
+            writeAssayCacheMetrics(metrics, assayCacheStats());
+            response.contentType = "text/plain; version=0.0.4";
+            response.body = metrics.str();
+            return;
+        }
+        if (request.path == "/summary") {
+            if (request.method != "GET") { setHttpError(response, 405, "use GET"); return; }
+            serviceSummary(response);
+            return;
+        }
+        if (request.path == "/price") {
+            if (request.method != "GET") { setHttpError(response, 405, "use GET"); return; }
+            GOLDASH_TIMED_SCOPE(TimedOperation::ServicePrice);
+            PriceSnapshot price = goldPrice.read();
+            JsonWriter(response.body).number("pricePerGram", price.pricePerGram).string("currency", settings.currencySymbol)
+                .number("timestamp", static_cast<double>(price.timestamp)).close();
+            return;
+        }
+        bool known = request.path == "/purity/weight" || request.path == "/purity/density" || request.path == "/alloy" || request.path == "/valuation";
+        if (!known) { setHttpError(response, 404, "unknown endpoint"); return; }
+        if (request.method != "POST") { setHttpError(response, 405, "use POST"); return; }
+
+        JsonFields fields(request.arena);
+        if (!fields.parse(request.body)) { setHttpError(response, 400, "body must be a flat JSON object"); return; }
+        int unit = 1;
+        std::string unitSymbol;
+        if (fields.getString("unit", unitSymbol) && (unit = parseMassUnit(unitSymbol)) == 0) {
+            setHttpError(response, 400, "unknown unit");
+            return;
+        }
+
+        if (request.path == "/purity/weight") servicePurity(fields, unit, true, response);
+        else if (request.path == "/purity/density") servicePurity(fields, unit, false, response);
+        else if (request.path == "/alloy") serviceAlloy(fields, unit, response);
+        else serviceValuation(fields, unit, response);
+    }
+
+    // The writer copies its totals under a lock, so any number of workers may ask concurrently.
+    void serviceSummary(HttpResponse& response) {
+        LogSummary summary = logWriter.summary();
+        std::time_t now = std::time(nullptr);
+        std::tm local_tm;
+        localtime_s(&local_tm, &now);
+        int32_t today = (local_tm.tm_year + 1900) * 10000 + (local_tm.tm_mon + 1) * 100 + local_tm.tm_mday;
+        const LogSummaryRecord empty = {};
+        const LogSummaryRecord* day = summary.find(today, CalculationType::Unknown);
+        const LogSummaryRecord* month = summary.find(summaryMonth(today), CalculationType::Unknown);
+        if (day == nullptr) day = &empty;
+        if (month == nullptr) month = &empty;
+        JsonWriter(response.body).number("day", today).number("todayRows", static_cast<double>(day->count))
+            .number("todayPureGoldGrams", day->pureGold).number("todayMarketValue", day->value.toDouble())
+            .number("todayMinPurity", day->minPurity).number("todayMaxPurity", day->maxPurity)
+            .number("monthRows", static_cast<double>(month->count)).number("monthPureGoldGrams", month->pureGold)
+            .number("monthMarketValue", month->value.toDouble()).number("monthMinPurity", month->minPurity)
+            .number("monthMaxPurity", month->maxPurity).string("currency", settings.currencySymbol).close();
+    }
+
+    void servicePurity(const JsonFields& fields, int unit, bool fromWeight, HttpResponse& response) {
+        GOLDASH_TIMED_SCOPE(TimedOperation::ServicePurity);
+        std::pmr::string impurityName(fields.memory()); // blend specs outgrow the small-string buffer
+        double stoneCarats = 0.0;
+        if (!fields.getString("impurity", impurityName)) { setHttpError(response, 400, "missing impurity"); return; }
+        if (fields.has("stoneCarats") && (!fields.getNumber("stoneCarats", stoneCarats) || stoneCarats < 0)) {
+            setHttpError(response, 400, "invalid stoneCarats");
+            return;
+        }
+        double stoneWeight = Mass<Grams>(Mass<Carats>(stoneCarats)).value();
+
+        double density = 0.0, metalMass;
+        if (fromWeight) {
+            double weightInAir, weightInWater;
+            if (!fields.getNumber("weightInAir", weightInAir) || !fields.getNumber("weightInWater", weightInWater)) {
+                setHttpError(response, 400, "weightInAir and weightInWater are required");
+                return;
+            }
+            metalMass = massToGrams(unit, weightInAir) - stoneWeight;
+            if (metalMass <= 0) { setHttpError(response, 400, "metal weight is zero or negative after stone deduction"); return; }
+            double metalInWater = massToGrams(unit, weightInWater) - stoneWeight;
+            if (metalMass > metalInWater && metalInWater > 0) density = metalMass / (metalMass - metalInWater);
+        }
+        else {
+            double mass;
+            if (!fields.getNumber("density", density) || !fields.getNumber("mass", mass)) {
+                setHttpError(response, 400, "density and mass are required");
+                return;
+            }
+            metalMass = massToGrams(unit, mass) - stoneWeight;
+            if (metalMass <= 0) { setHttpError(response, 400, "metal weight is zero or negative after stone deduction"); return; }
+        }
+
+        // A blend the registry does not know is priced for this request only; registering it here
+        // would take the exclusive lock and grow the registry with every new spec a client sends.
+        MetalId impurity;
+        double impurityDensity;
+        KaratDensityTable karatTable;
+        {
+            std::shared_lock<std::shared_mutex> lock(metalsMutex);
+            if (!lookupImpurityDensity(metals, impurityName.c_str(), impurityName.size(), impurity, impurityDensity)) { setHttpError(response, 400, "unknown impurity"); return; }
+            karatTable = impurity != INVALID_METAL_ID ? karatDensityTable(metals.get(impurity)) : makeKaratDensityTable(impurityDensity);
+        }
+
+        PurityResult result = cachedAssay(metalMass, density, impurityDensity);
+        int nearestKarat = nearestTableKarat(karatTable, density);
+        JsonWriter(response.body).string("impurity", impurityName).number("density", density)
+            .boolean("densityValid", isDensityInRange(density, impurityDensity)).number("purityPercent", result.purityPercent)
+            .number("karat", result.karats).number("nearestKarat", nearestKarat).number("pureGoldGrams", result.pureGoldGrams)
+            .number("marketValue", result.pureGoldGrams * goldPricePerGram()).string("currency", settings.currencySymbol).close();
+    }
+
+    void serviceAlloy(const JsonFields& fields, int unit, HttpResponse& response) {
+        GOLDASH_TIMED_SCOPE(TimedOperation::ServiceAlloy);
+        double mass, karat, targetKarat, fineGoldKarat = 24.0;
+        if (!fields.getNumber("mass", mass) || !fields.getNumber("karat", karat) || !fields.getNumber("targetKarat", targetKarat)
+            || (fields.has("fineGoldKarat") && !fields.getNumber("fineGoldKarat", fineGoldKarat))) {
+            setHttpError(response, 400, "mass, karat and targetKarat are required");
+            return;
+        }
+        double massGrams = massToGrams(unit, mass);
+        if (massGrams <= 0 || karat <= 0 || karat > 24 || targetKarat <= 0 || targetKarat > 24 || fineGoldKarat <= 0 || fineGoldKarat > 24) {
+            setHttpError(response, 400, "mass must be positive and karats between 0 and 24");
+            return;
+        }
+        AlloyAddition addition = planAlloyAddition(massGrams, karat, targetKarat, fineGoldKarat);
+        JsonWriter(response.body).boolean("reachable", addition.reachable).number("fineGoldGrams", addition.fineGoldGrams)
+            .number("alloyGrams", addition.alloyGrams).number("finalMassGrams", massGrams + addition.fineGoldGrams + addition.alloyGrams).close();
+    }
+
+    void serviceValuation(const JsonFields& fields, int unit, HttpResponse& response) {
+        GOLDASH_TIMED_SCOPE(TimedOperation::ServiceValuation);
+        double mass, karat;
+        if (!fields.getNumber("mass", mass) || !fields.getNumber("karat", karat) || mass <= 0 || karat <= 0 || karat > 24) {
+            setHttpError(response, 400, "positive mass and karat up to 24 are required");
+            return;
+        }
+        double pureGold = massToGrams(unit, mass) * (karat / 24.0);
+        double pricePerGram = goldPricePerGram();
+        JsonWriter(response.body).number("pureGoldGrams", pureGold).number("pricePerGram", pricePerGram)
+            .number("value", pureGold * pricePerGram).string("currency", settings.currencySymbol).close();
+    }
+
+    void displayDateTime(std::ostream& out) {
         auto now = std::chrono::system_clock::now();
         std::time_t now_time = std::chrono::system_clock::to_time_t(now);
         std::tm local_tm;
         localtime_s(&local_tm, &now_time);
-        std::cout << "  Multan, Pakistan | " << std::put_time(&local_tm, "%a, %d %b %Y, %H:%M PKT") << "\n";
+        out << "  Multan, Pakistan | " << std::put_time(&local_tm, "%a, %d %b %Y, %H:%M PKT") << "\n";
     }
 
     void displayMenu() {
-        clearScreen();
-        std::cout << "***************************************************\n";
-        std::cout << "* G O L D   &   A L L O Y   T O O L K I T         *\n";
-        std::cout << "***************************************************\n";
-        displayDateTime();
-        std::cout << "---------------------------------------------------\n";
-        std::cout << "  Current Gold Price: " << settings.currencySymbol << std::fixed << std::setprecision(2)
-            << (goldPricePerGram > 0 ? goldPricePerGram : 0.0) << "/gram\n";
-        std::cout << "---------------------------------------------------\n\n";
-        std::cout << "  1. Calculate Purity (from Weight)\n";
-        std::cout << "  2. Calculate Purity (from Density)\n";
-        std::cout << "  3. Alloying: Create New Alloy\n";
-        std::cout << "  4. Alloying: Raise Karat of Existing Alloy\n";
-        std::cout << "  5. Financial: 'What-If' Investment Calculator\n";
-        std::cout << "  6. View Calculation Log (CSV)\n";
-        std::cout << "  7. Manage Metals\n";
-        std::cout << "  8. Settings & Configuration\n";
-        std::cout << "  9. Help & About\n";
-        std::cout << "  10. Exit\n\n";
-        std::cout << "===================================================\n";
-        std::cout << "  Enter your choice: ";
+        std::ostringstream screen;
+        screen << "***************************************************\n";
+        screen << "* G O L D   &   A L L O Y   T O O L K I T         *\n";
+        screen << "***************************************************\n";
+        displayDateTime(screen);
+        screen << "---------------------------------------------------\n";
+        double pricePerGram = goldPricePerGram();
+        screen << "  Current Gold Price: " << settings.currencySymbol << std::fixed << std::setprecision(2)
+            << (pricePerGram > 0 ? pricePerGram : 0.0) << "/gram" << (priceFeed ? " (live)" : "") << "\n";
+        size_t saving = io.pending();
+        if (saving > 0) screen << "  Saving " << saving << " file(s) in the background...\n";
+        for (const std::string& failed : io.takeFailures()) screen << "  Warning: could not save " << failed << ".\n";
+        screen << "---------------------------------------------------\n\n";
+        screen << "  1. Calculate Purity (from Weight)\n";
+        screen << "  2. Calculate Purity (from Density)\n";
+        screen << "  3. Alloying: Create New Alloy\n";
+        screen << "  4. Alloying: Raise Karat of Existing Alloy\n";
+        screen << "  5. Financial: 'What-If' Investment Calculator\n";
+        screen << "  6. View Calculation Log (CSV)\n";
+        screen << "  7. Manage Metals\n";
+        screen << "  8. Settings & Configuration\n";
+        screen << "  9. Help & About\n";
+        screen << "  10. Performance Instrumentation\n";
+        screen << "  11. Exit\n\n";
+        screen << "===================================================\n";
+        screen << "  Enter your choice: ";
+        presentScreen(screen.str());
+        std::cout << std::fixed << std::setprecision(2); // the calculators print in the menu's number format
     }
 
     void handleMenuChoice(int choice) {
@@ -201,11 +1121,11 @@ private:
         case 7: manageMetals(); break;
         case 8: manageSettings(); break;
         case 9: displayHelp(); break;
-        case 10:
-            clearScreen();
-            std::cout << "\n***************************************************\n";
-            std::cout << "* Thank you for using the Toolkit! Goodbye!       *\n";
-            std::cout << "***************************************************\n\n";
+        case 10: viewInstrumentation(); break;
+        case 11:
+            presentScreen("\n***************************************************\n"
+                "* Thank you for using the Toolkit! Goodbye!       *\n"
+                "***************************************************\n\n");
             break;
         default: std::cout << "Invalid choice. Please try again.\n";
         }
@@ -232,13 +1152,95 @@ private:
             return 0.0;
         }
 
-        switch (choice) {
-        case 2: return value * GRAMS_PER_TROY_OUNCE;
-        case 3: return value * GRAMS_PER_OUNCE;
-        case 4: return value * GRAMS_PER_PENNYWEIGHT;
-        case 5: return value * GRAMS_PER_TOLA;
-        default: return value;
+        return massToGrams(choice, value);
+    }
+
+    // --- Balance Input ---
+
+    static const size_t NO_BALANCE = static_cast<size_t>(-1);
+
+    // The balance to weigh on for one calculation, or NO_BALANCE to type the weights.
+    size_t chooseBalance() {
+        if (balances.size() == 0) return NO_BALANCE;
+        if (balances.size() == 1) return balances.state(0).connected ? 0 : NO_BALANCE;
+        std::cout << "\nRead the weights from:\n";
+        for (size_t i = 0; i < balances.size(); ++i) {
+            BalanceState state = balances.state(i);
+            std::cout << "  " << i + 1 << ". " << state.port << (state.connected ? "" : " (disconnected)") << "\n";
+        }
+        std::cout << "  0. Type them in\n  Choice: ";
+        size_t choice = 0;
+        std::cin >> choice;
+        if (!std::cin.good() || choice == 0 || choice > balances.size() || !balances.state(choice - 1).connected) {
+            std::cin.clear();
+            return NO_BALANCE;
+        }
+        return choice - 1;
+    }
+
+    // Shows the balance's live reading until the operator presses Enter on a stable weight or types
+    // the weight instead (in the default unit). usedWeight is the stable weight taken last, so the
+    // item has to move before the same weight is offered again. Like getMassInGrams, it leaves the
+    // answer's newline unread.
+    double weigh(size_t balance, const std::string& prompt, const char* instruction, uint64_t& usedWeight) {
+        if (balance == NO_BALANCE) return getMassInGrams(prompt);
+        const char* unitSymbol = withMassUnit(settings.defaultWeightUnit, [](auto tag) { return decltype(tag)::SYMBOL; });
+        BalanceState state = balances.state(balance);
+        std::cout << prompt << "\n  " << instruction << " on " << state.port << " and press Enter on a stable reading,\n"
+            << "  or type the weight in " << unitSymbol << ".\n";
+        clearInputBuffer(); // the previous answer's newline
+        for (;;) {
+            std::atomic<bool> keyPressed{ false };
+            std::thread keyWatcher([&keyPressed]() {
+                std::cin.peek(); // waits for input without taking it
+                keyPressed = true;
+            });
+            std::string shown;
+            while (!keyPressed) {
+                state = balances.waitForReading(balance, state.readings, std::chrono::milliseconds(100));
+                std::string line = describeBalance(state, usedWeight);
+                if (line != shown) {
+                    std::cout << "\r  " << std::left << std::setw(60) << line << std::right << std::flush;
+                    shown = line;
+                }
+            }
+            keyWatcher.join();
+            std::cout << "\n";
+
+            state = balances.state(balance);
+            int next = std::cin.peek();
+            if (next == '\n') {
+                if (state.holding && state.stableSequence != usedWeight) {
+                    usedWeight = state.stableSequence;
+                    std::cout << "  Using " << std::setprecision(4) << state.stableGrams << " g from the balance.\n" << std::setprecision(2);
+                    return state.stableGrams;
+                }
+                std::cout << "  No new stable reading yet.\n";
+                clearInputBuffer();
+                continue;
+            }
+            double value;
+            std::cin >> value;
+            if (!std::cin.good() || value <= 0) {
+                std::cout << "Invalid input.\n";
+                clearInputBuffer();
+                return 0.0;
+            }
+            return massToGrams(settings.defaultWeightUnit, value);
+        }
+    }
+
+    static std::string describeBalance(const BalanceState& state, uint64_t usedWeight) {
+        char line[96];
+        if (!state.connected) return "Balance disconnected: type the weight instead.";
+        if (state.readings == 0) return "Waiting for the balance...";
+        if (state.holding && state.stableSequence != usedWeight) {
+            std::snprintf(line, sizeof(line), "Stable: %.4f g  [Enter] to use it", state.stableGrams);
+        }
+        else {
+            std::snprintf(line, sizeof(line), "Reading: %.4f g (settling)", state.latest.grams);
         }
+        return line;
     }
 
     double getStoneWeightInGrams() {
@@ -247,12 +1249,42 @@ private:
         std::cin >> hasStones;
         if (hasStones == 'y' || hasStones == 'Y') {
             double stoneCarats = getValidatedNumericInput("Enter total stone weight in Carats: ");
-            return stoneCarats * GRAMS_PER_CARAT;
+            return Mass<Grams>(Mass<Carats>(stoneCarats)).value();
         }
         return 0.0;
     }
 
-    Metal chooseImpurity() { /* ... unchanged ... */ return Metal(); }
+    void listMetals() {
+        for (MetalId id = 0; id < metals.size(); ++id) {
+            const Metal& metal = metals.get(id);
+            std::cout << "  " << id + 1 << ". " << metal.name << " (" << metal.density << " g/cm^3)\n";
+        }
+    }
+
+    MetalId chooseImpurity(bool allowBlends = true) {
+        std::cout << "\nSelect the assumed impurity metal:\n";
+        listMetals();
+        if (allowBlends) std::cout << "  Or enter a blend by mass ratio, e.g. Silver:3+Copper:1\n";
+        std::cout << "  Choice: ";
+        std::string choice;
+        std::cin >> choice;
+
+        char* end = nullptr;
+        unsigned long index = std::strtoul(choice.c_str(), &end, 10);
+        MetalId id = INVALID_METAL_ID;
+        if (!choice.empty() && *end == '\0') {
+            if (index >= 1 && index <= metals.size()) id = static_cast<MetalId>(index - 1);
+        }
+        else {
+            std::unique_lock<std::shared_mutex> lock(metalsMutex); // resolveImpurity may register a blend
+            id = allowBlends ? resolveImpurity(metals, choice) : metals.find(choice);
+            if (id != INVALID_METAL_ID && metals.isBlend(id)) {
+                std::cout << "  Effective impurity density: " << metals.get(id).density << " g/cm^3\n";
+            }
+        }
+        if (id == INVALID_METAL_ID) std::cout << "Invalid choice.\n";
+        return id;
+    }
 
     void performPurityFromWeight() {
         clearScreen();
@@ -261,11 +1293,14 @@ private:
         item.setImpurity(chooseImpurity());
 
         double stoneWeight = getStoneWeightInGrams();
-        double weightInAir = getMassInGrams("\nEnter weight in air:") - stoneWeight;
-        double weightInWater = getMassInGrams("\nEnter weight in water:") - stoneWeight;
+        size_t balance = chooseBalance();
+        uint64_t usedWeight = 0;
+        double weightInAir = weigh(balance, "\nEnter weight in air:", "Place the item on the pan", usedWeight) - stoneWeight;
+        double weightInWater = weigh(balance, "\nEnter weight in water:", "Hang the item in the water basket", usedWeight) - stoneWeight;
 
         if (weightInAir <= 0) { std::cout << "Metal weight is zero or negative after stone deduction.\n"; return; }
 
+        GOLDASH_TIMED_SCOPE(TimedOperation::PurityFromWeight);
         item.calculateDensityFromWeight(weightInAir, weightInWater);
         displayPurityResults(item, "PurityFromWeight");
     }
@@ -283,6 +1318,7 @@ private:
         if (mass <= 0) { std::cout << "Metal weight is zero or negative after stone deduction.\n"; return; }
         item.setTotalMass(mass);
 
+        GOLDASH_TIMED_SCOPE(TimedOperation::PurityFromDensity);
         displayPurityResults(item, "PurityFromDensity");
     }
 
@@ -294,43 +1330,437 @@ private:
         clearScreen();
         std::cout << "+-----------------------------------------------+\n|   'What-If' Investment Value Calculator       |\n+-----------------------------------------------+\n";
 
-        double totalPureGold = 0;
-        char addMore;
-        do {
-            std::cout << "\n--- Add Gold Holding ---\n";
-            double mass = getMassInGrams("Enter mass of this holding:");
-            double karat = getValidatedNumericInput("Enter Karat of this holding: ");
-            if (karat > 24) karat = 24;
-            totalPureGold += mass * (karat / 24.0);
-            std::cout << "Add another holding? (y/n): ";
-            std::cin >> addMore;
-        } while (addMore == 'y' || addMore == 'Y');
+        Portfolio portfolio;
+        portfolio.load(PORTFOLIO_FILENAME);
+        bool addHoldings = true;
+        if (!portfolio.holdings.empty()) {
+            std::cout << "\nSaved portfolio: " << portfolio.holdings.size() << " holding(s).\n";
+            std::cout << "  1. Revalue saved holdings\n  2. Add holdings to saved portfolio\n  3. Start a new portfolio\n  Choice: ";
+            int choice;
+            std::cin >> choice;
+            if (choice == 3) portfolio.holdings.clear();
+            addHoldings = (choice == 2 || choice == 3);
+        }
+
+        if (addHoldings) {
+            char addMore;
+            do {
+                std::cout << "\n--- Add Gold Holding ---\n";
+                double mass = getMassInGrams("Enter mass of this holding:");
+                double karat = getValidatedNumericInput("Enter Karat of this holding: ");
+                if (karat > 24) karat = 24;
+                std::cout << "Tag for this holding (optional): ";
+                clearInputBuffer();
+                std::string tag;
+                std::getline(std::cin, tag);
+                portfolio.holdings.emplace_back(mass, karat, tag, static_cast<int64_t>(std::time(nullptr)));
+                std::cout << "Add another holding? (y/n): ";
+                std::cin >> addMore;
+            } while (addMore == 'y' || addMore == 'Y');
+            io.submit(PORTFOLIO_FILENAME, [portfolio]() { return portfolio.save(PORTFOLIO_FILENAME); });
+        }
+
+        std::cout << "\nEnter future target prices per gram (separated by spaces): ";
+        clearInputBuffer();
+        std::string priceLine;
+        std::getline(std::cin, priceLine);
+        std::vector<double> prices;
+        std::istringstream priceStream(priceLine);
+        for (double price; priceStream >> price;) {
+            if (price > 0) prices.push_back(price);
+        }
+        if (prices.empty()) { std::cout << "No valid prices entered.\n"; return; }
+
+        double currentPrice = goldPricePerGram();
+        std::unique_lock<std::mutex> historyLock(priceHistoryMutex);
+        RevaluationEngine engine(portfolio, &history());
+        historyLock.unlock();
+        RevaluationResult result;
+        {
+            GOLDASH_TIMED_SCOPE(TimedOperation::Investment);
+            result = engine.revalue(prices, currentPrice);
+        }
 
         std::cout << "\n--- Projections ---\n";
-        std::cout << "Total pure gold in portfolio: " << std::fixed << std::setprecision(2) << totalPureGold << " grams.\n";
+        std::cout << "Total pure gold in portfolio: " << std::fixed << std::setprecision(2) << result.totalPureGold
+            << " grams across " << portfolio.holdings.size() << " holding(s).\n\n";
+        for (size_t p = 0; p < prices.size(); ++p) {
+            std::cout << "At a future price of " << settings.currencySymbol << prices[p] << "/gram:\n";
+            std::cout << "  -> Projected Portfolio Value: " << settings.currencySymbol << result.totalValue[p] << "\n";
+            if (result.currentValue > Money()) {
+                Money profit = result.totalProfit[p];
+                double percentageChange = (profit.toDouble() / result.currentValue.toDouble()) * 100.0;
+                std::cout << "  -> Change from current value: " << settings.currencySymbol << profit
+                    << " (" << (profit > Money() ? "+" : "") << percentageChange << "%)\n";
+            }
+        }
 
-        double futurePrice = getValidatedNumericInput("Enter a future target price per gram: ");
-        double futureValue = totalPureGold * futurePrice;
-        double currentValue = totalPureGold * goldPricePerGram;
+        if (result.totalCostBasis > Money()) {
+            std::cout << "\nCost basis at the prices in effect when acquired: " << settings.currencySymbol << result.totalCostBasis;
+            if (result.holdingsWithoutCost > 0) std::cout << " (" << result.holdingsWithoutCost << " holding(s) without a recorded price)";
+            std::cout << "\n";
+        }
 
-        std::cout << "\nAt a future price of " << settings.currencySymbol << futurePrice << "/gram:\n";
-        std::cout << "  -> Projected Portfolio Value: " << settings.currencySymbol << futureValue << "\n";
-        if (currentValue > 0) {
-            double profit = futureValue - currentValue;
-            double percentageChange = (profit / currentValue) * 100.0;
-            std::cout << "  -> Change from current value: " << settings.currencySymbol << profit
-                << " (" << (profit > 0 ? "+" : "") << percentageChange << "%)\n";
+        std::cout << "\nWrite per-holding P/L to '" << REVALUATION_REPORT_FILENAME << "'? (y/n): ";
+        char writeReport;
+        std::cin >> writeReport;
+        if (writeReport == 'y' || writeReport == 'Y') {
+            std::ofstream report(REVALUATION_REPORT_FILENAME);
+            if (report.is_open()) {
+                engine.writeHoldingReport(report, prices, currentPrice);
+                std::cout << "Report written.\n";
+            }
+            else {
+                std::cout << "Could not write report.\n";
+            }
         }
+
+        std::cout << "Sweep holding values across a price x karat grid? (y/n): ";
+        char runSweep;
+        std::cin >> runSweep;
+        if (runSweep == 'y' || runSweep == 'Y') performPriceKaratSweep(portfolio, currentPrice);
+
+        std::cout << "Run Monte Carlo price scenarios for this portfolio? (y/n): ";
+        char runScenarios;
+        std::cin >> runScenarios;
+        if (runScenarios == 'y' || runScenarios == 'Y') performScenarioSimulation(result.totalPureGold);
     }
 
-    void viewCalculationLog() { /* ... unchanged ... */ }
-    void manageMetals() { /* ... unchanged ... */ }
+    void performPriceKaratSweep(const Portfolio& portfolio, double currentPrice) {
+        const size_t DEFAULT_PRICE_POINTS = 200;
+        const size_t MAX_PRICE_POINTS = 200; // the grid is held in memory: prices x 24 karats x holdings
+        const double DEFAULT_PRICE_SPAN = 0.2; // +/- 20% of the current price
+        std::cout << "\n--- Price x Karat Sweep ---\n";
+        clearInputBuffer();
+        std::cout << "Price range per gram as 'low high' (Enter for the current price +/-20%): ";
+        std::string line;
+        std::getline(std::cin, line);
+        double low = currentPrice * (1.0 - DEFAULT_PRICE_SPAN), high = currentPrice * (1.0 + DEFAULT_PRICE_SPAN);
+        std::istringstream range(line);
+        if (!line.empty() && !(range >> low >> high)) { std::cout << "Invalid price range.\n"; return; }
+        if (low <= 0 || high < low) { std::cout << "Set a current gold price or enter a positive range.\n"; return; }
+
+        std::cout << "Number of price points (1-" << MAX_PRICE_POINTS << ", Enter for " << DEFAULT_PRICE_POINTS << "): ";
+        std::getline(std::cin, line);
+        size_t pricePoints = line.empty() ? DEFAULT_PRICE_POINTS : static_cast<size_t>(std::max(1, std::atoi(line.c_str())));
+        if (pricePoints > MAX_PRICE_POINTS) {
+            std::cout << "Using the maximum of " << MAX_PRICE_POINTS << " price points.\n";
+            pricePoints = MAX_PRICE_POINTS;
+        }
+        std::cout << "Quote prices per (g ozt oz dwt tola, several allowed; Enter for g): ";
+        std::getline(std::cin, line);
+        std::vector<int> units;
+        std::istringstream symbols(line);
+        for (std::string symbol; symbols >> symbol;) {
+            int unit = parseMassUnit(symbol);
+            if (unit != 0 && std::find(units.begin(), units.end(), unit) == units.end()) units.push_back(unit);
+        }
+        if (units.empty()) units.push_back(1);
+
+        std::vector<int> karats;
+        for (int karat = 1; karat <= 24; ++karat) karats.push_back(karat);
+        auto started = std::chrono::steady_clock::now();
+        SweepGrid grid = sweepPriceKaratGrid(portfolio, priceLadder(low, high, pricePoints), karats);
+        double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        std::cout << grid.values.size() * units.size() << " cells (" << pricePoints << " prices x 24 karats x " << units.size()
+            << " unit(s) x " << grid.columns << " columns) in " << std::setprecision(2) << millis << " ms.\n";
+
+        std::cout << "  1. Page through totals\n  2. Write every holding to '" << SWEEP_REPORT_FILENAME << "'\n  Choice: ";
+        int choice;
+        std::cin >> choice;
+        if (choice == 1) {
+            pageSweepGrid(grid, units);
+        }
+        else if (choice == 2) {
+            std::ofstream report(SWEEP_REPORT_FILENAME, std::ios::binary);
+            if (!report.is_open()) { std::cout << "Could not write " << SWEEP_REPORT_FILENAME << ".\n"; return; }
+            writeSweepCsv(report, portfolio, grid, units);
+            std::cout << "Sweep written.\n";
+        }
+    }
+
+    // Portfolio totals, one price per row and the common karats across, a page at a time.
+    void pageSweepGrid(const SweepGrid& grid, const std::vector<int>& units) {
+        const size_t PAGE_ROWS = 20;
+        const int SHOWN_KARATS[] = { 24, 22, 21, 18, 14, 10, 9 };
+        size_t unitIndex = 0;
+        size_t first = 0;
+        clearInputBuffer();
+        for (;;) {
+            int unit = units[unitIndex];
+            const char* symbol = withMassUnit(unit, [](auto tag) { return decltype(tag)::SYMBOL; });
+            double gramsPerUnit = withMassUnit(unit, [](auto tag) { return decltype(tag)::GRAMS_PER_UNIT; });
+            size_t last = std::min(first + PAGE_ROWS, grid.pricesPerGram.size());
+
+            std::ostringstream screen;
+            screen << "+-----------------------------+\n|   Price x Karat Sweep       |\n+-----------------------------+\n";
+            screen << "Portfolio value by price per " << symbol << " and karat | prices " << first + 1 << "-" << last
+                << " of " << grid.pricesPerGram.size() << "\n\n" << std::fixed << std::setprecision(2);
+            screen << std::setw(14) << ("Price/" + std::string(symbol));
+            for (int karat : SHOWN_KARATS) screen << std::setw(14) << std::to_string(karat) + "K";
+            screen << "\n";
+            for (size_t p = first; p < last; ++p) {
+                screen << std::setw(14) << grid.pricesPerGram[p] * gramsPerUnit;
+                for (int karat : SHOWN_KARATS) screen << std::setw(14) << grid.row(p, static_cast<size_t>(karat - 1))[grid.columns - 1];
+                screen << "\n";
+            }
+            screen << "\n[n] Next  [p] Previous  [u] Next unit  [q] Back\nChoice: ";
+            presentScreen(screen.str());
+
+            std::string command;
+            if (!std::getline(std::cin, command)) return;
+            if (command.empty()) continue;
+            char key = static_cast<char>(std::tolower(static_cast<unsigned char>(command[0])));
+            if (key == 'q') return;
+            if (key == 'n' && last < grid.pricesPerGram.size()) first = last;
+            else if (key == 'p') first = first >= PAGE_ROWS ? first - PAGE_ROWS : 0;
+            else if (key == 'u') unitIndex = (unitIndex + 1) % units.size();
+        }
+    }
+
+    void performScenarioSimulation(double totalPureGold) {
+        const size_t MAX_SCENARIO_PATHS = 10000000; // every terminal value is held in memory, 8 bytes each
+        double currentPrice = goldPricePerGram();
+        if (currentPrice <= 0) { std::cout << "Set a current gold price first.\n"; return; }
+        std::cout << "\n--- Monte Carlo Price Scenarios ---\n";
+        std::cout << "  1. Geometric Brownian motion\n  2. Bootstrap from price history ('" << PRICE_FILENAME << "')\n  Choice: ";
+        int modelChoice;
+        std::cin >> modelChoice;
+
+        ScenarioConfig config;
+        if (modelChoice == 2) {
+            config.model = ScenarioModel::Bootstrap;
+            std::lock_guard<std::mutex> lock(priceHistoryMutex);
+            config.dailyLogReturns = dailyLogReturns(history().dailyClosingPrices());
+            if (config.dailyLogReturns.empty()) { std::cout << "Not enough price history to bootstrap from.\n"; return; }
+        }
+        else {
+            config.annualDrift = getValidatedNumericInput("Expected annual drift (%): ") / 100.0;
+            config.annualVolatility = getValidatedNumericInput("Annual volatility (%): ") / 100.0;
+        }
+        double horizon = getValidatedNumericInput("Horizon in days: ");
+        if (horizon >= 1) config.horizonDays = static_cast<int>(horizon);
+        double paths = getValidatedNumericInput("Number of paths (e.g. 1000000): ");
+        if (paths > static_cast<double>(MAX_SCENARIO_PATHS)) {
+            std::cout << "Using the maximum of " << MAX_SCENARIO_PATHS << " paths.\n";
+            paths = static_cast<double>(MAX_SCENARIO_PATHS);
+        }
+        if (paths >= 1) config.paths = static_cast<size_t>(paths);
+        config.seed = static_cast<uint64_t>(getValidatedNumericInput("Random seed: "));
+
+        auto started = std::chrono::steady_clock::now();
+        ScenarioResult scenarios;
+        {
+            GOLDASH_TIMED_SCOPE(TimedOperation::Scenarios);
+            scenarios = simulatePriceScenarios(config, currentPrice, totalPureGold);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        std::cout << "\n" << config.paths << " paths over " << config.horizonDays << " days (" << std::setprecision(2) << seconds << " s):\n";
+        for (size_t i = 0; i < scenarios.percentileLevels.size(); ++i) {
+            std::cout << "  P" << std::setw(2) << std::left << scenarios.percentileLevels[i] << std::right << std::setprecision(2)
+                << "  Portfolio value: " << settings.currencySymbol << scenarios.percentileValues[i] << "\n";
+        }
+        std::cout << "  Mean portfolio value: " << settings.currencySymbol << scenarios.meanValue << "\n";
+        std::cout << "  Probability of loss vs current value: " << scenarios.probabilityOfLoss * 100.0 << "%\n";
+    }
+
+    void viewCalculationLog() {
+        const size_t PAGE_ROWS = 20;
+        logWriter.flush();
+        CsvLogPager pager;
+        if (!pager.open(LOG_FILENAME)) {
+            clearScreen();
+            std::cout << "No calculation log found (" << LOG_FILENAME << ").\n";
+            return;
+        }
+
+        CalculationType filter = CalculationType::Unknown;
+        std::vector<uint64_t> newerPageEnds;
+        uint64_t pageEnd = pager.size();
+        std::vector<std::string> page;
+        uint64_t olderEnd = pager.readPageBefore(pageEnd, PAGE_ROWS, filter, page);
+        clearInputBuffer();
+
+        for (;;) {
+            std::string screen = "+-----------------------------+\n|   Calculation Log Viewer    |\n+-----------------------------+\n";
+            screen += "Filter: ";
+            screen += filter == CalculationType::Unknown ? "All" : calculationTypeName(filter);
+            screen += " | Page " + std::to_string(newerPageEnds.size() + 1) + " (newest first)\n\n";
+            screen += LOG_CSV_HEADER;
+            screen += "\n";
+            for (const std::string& row : page) screen += row + "\n";
+            if (page.empty()) screen += "(no entries)\n";
+            screen += "\n[n] Older  [p] Newer  [f] Filter  [s] Summary  [t] Follow  [q] Back\nChoice: ";
+            presentScreen(screen);
+
+            std::string command;
+            if (!std::getline(std::cin, command) || command.empty()) continue;
+            char key = static_cast<char>(std::tolower(static_cast<unsigned char>(command[0])));
+            if (key == 'q') return;
+            if (key == 'n' && olderEnd > 0) {
+                std::vector<std::string> older;
+                uint64_t next = pager.readPageBefore(olderEnd, PAGE_ROWS, filter, older);
+                if (older.empty()) { olderEnd = 0; continue; }
+                newerPageEnds.push_back(pageEnd);
+                pageEnd = olderEnd;
+                olderEnd = next;
+                page.swap(older);
+            }
+            else if (key == 'p' && !newerPageEnds.empty()) {
+                pageEnd = newerPageEnds.back();
+                newerPageEnds.pop_back();
+                olderEnd = pager.readPageBefore(pageEnd, PAGE_ROWS, filter, page);
+            }
+            else if (key == 'f') {
+                std::cout << "  0. All\n";
+                for (int32_t i = 1; i <= static_cast<int32_t>(CalculationType::Investment); ++i) {
+                    std::cout << "  " << i << ". " << calculationTypeName(static_cast<CalculationType>(i)) << "\n";
+                }
+                std::cout << "  Filter: ";
+                std::string selection;
+                std::getline(std::cin, selection);
+                int index = std::atoi(selection.c_str());
+                if (index < 0 || index > static_cast<int>(CalculationType::Investment)) index = 0;
+                filter = static_cast<CalculationType>(index);
+                newerPageEnds.clear();
+                pageEnd = pager.size();
+                olderEnd = pager.readPageBefore(pageEnd, PAGE_ROWS, filter, page);
+            }
+            else if (key == 's') {
+                displayLogSummary(filter);
+            }
+            else if (key == 't') {
+                followCalculationLog(pager, filter, PAGE_ROWS);
+                newerPageEnds.clear();
+                pageEnd = pager.size();
+                olderEnd = pager.readPageBefore(pageEnd, PAGE_ROWS, filter, page);
+            }
+        }
+    }
+
+    // Today, this month and recent months from the writer's running totals, for the viewer's filter.
+    void displayLogSummary(CalculationType filter) {
+        const size_t MONTHS_SHOWN = 12;
+        LogSummary summary = logWriter.summary();
+        std::time_t now = std::time(nullptr);
+        std::tm local_tm;
+        localtime_s(&local_tm, &now);
+        int32_t today = (local_tm.tm_year + 1900) * 10000 + (local_tm.tm_mon + 1) * 100 + local_tm.tm_mday;
+
+        std::ostringstream screen;
+        screen << "+-----------------------------+\n|   Calculation Log Summary   |\n+-----------------------------+\n";
+        screen << "Filter: " << (filter == CalculationType::Unknown ? "All" : calculationTypeName(filter)) << "\n\n";
+        screen << std::left << std::setw(12) << "Period" << std::right << std::setw(9) << "Rows" << std::setw(15) << "PureGold(g)"
+            << std::setw(18) << "MarketValue" << std::setw(20) << "Purity(%) min-max" << "\n" << std::fixed;
+        auto row = [&](const std::string& label, const LogSummaryRecord* totals) {
+            screen << std::left << std::setw(12) << label << std::right;
+            if (totals == nullptr) { screen << std::setw(9) << 0 << "\n"; return; }
+            std::ostringstream purity;
+            purity << std::fixed << std::setprecision(2) << totals->minPurity << "-" << totals->maxPurity;
+            screen << std::setw(9) << totals->count << std::setprecision(3) << std::setw(15) << totals->pureGold << std::setprecision(2)
+                << std::setw(18) << settings.currencySymbol + totals->value.toString()
+                << std::setw(20) << purity.str() << "\n";
+        };
+        row("Today", summary.find(today, filter));
+        row("This month", summary.find(summaryMonth(today), filter));
+
+        std::vector<const LogSummaryRecord*> months;
+        for (const LogSummaryRecord& entry : summary.entries()) {
+            if (entry.period % 100 == 0 && entry.calcType == static_cast<int32_t>(filter)) months.push_back(&entry);
+        }
+        std::sort(months.begin(), months.end(), [](const LogSummaryRecord* a, const LogSummaryRecord* b) { return a->period > b->period; });
+        if (months.size() > MONTHS_SHOWN) months.resize(MONTHS_SHOWN);
+        screen << "\nBy month (most recent first):\n";
+        for (const LogSummaryRecord* month : months) {
+            char label[16];
+            std::snprintf(label, sizeof(label), "%04d-%02d", month->period / 10000, month->period / 100 % 100);
+            row(label, month);
+        }
+        if (months.empty()) screen << "(no entries)\n";
+        screen << "\nPress Enter to return to the log...";
+        presentScreen(screen.str());
+        std::string ignored;
+        std::getline(std::cin, ignored);
+    }
+
+    // tail -f style view: prints the newest rows, then new rows as they are written, until Enter.
+    void followCalculationLog(CsvLogPager& pager, CalculationType filter, size_t initialRows) {
+        clearScreen();
+        std::cout << "Following " << LOG_FILENAME << " (press Enter to stop)...\n\n" << LOG_CSV_HEADER << "\n";
+        uint64_t offset = pager.size();
+        std::vector<std::string> rows;
+        pager.readPageBefore(offset, initialRows, filter, rows);
+        for (const std::string& row : rows) std::cout << row << "\n";
+        std::cout.flush();
+
+        std::atomic<bool> stopRequested{ false };
+        std::thread keyWatcher([&stopRequested]() {
+            std::string ignored;
+            std::getline(std::cin, ignored);
+            stopRequested = true;
+        });
+        while (!stopRequested) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+            logWriter.flush();
+            uint64_t size = pager.size();
+            if (size < offset) offset = 0; // log was truncated or replaced
+            rows.clear();
+            offset = pager.readRowsAfter(offset, size, filter, rows);
+            for (const std::string& row : rows) std::cout << row << "\n";
+            if (!rows.empty()) std::cout.flush();
+        }
+        keyWatcher.join();
+    }
+    void manageMetals() {
+        clearScreen();
+        std::cout << "+---------------------+\n|   Manage Metals     |\n+---------------------+\n";
+        std::cout << "  1. List Metals\n  2. Add Metal\n  3. Change Metal Density\n  4. Karat Density Table\n  Choice: ";
+        int choice;
+        std::cin >> choice;
+        if (choice == 1) {
+            std::cout << "\n";
+            listMetals();
+        }
+        else if (choice == 2) {
+            Metal metal;
+            std::cout << "Enter metal name (no spaces): ";
+            std::cin >> metal.name;
+            metal.density = getValidatedNumericInput("Enter density (g/cm^3): ");
+            if (metal.density <= 0) { std::cout << "Invalid density.\n"; return; }
+            {
+                std::unique_lock<std::shared_mutex> lock(metalsMutex);
+                metals.add(metal); // may replace the density of a metal with that name
+            }
+            invalidateAssayCaches();
+            saveMetals();
+            std::cout << metal.name << " saved.\n";
+        }
+        else if (choice == 3) {
+            MetalId id = chooseImpurity(false);
+            if (id == INVALID_METAL_ID) return;
+            if (metals.isBlend(id)) { std::cout << "A blend's density follows its components.\n"; return; }
+            double density = getValidatedNumericInput("Enter new density (g/cm^3): ");
+            if (density <= 0) { std::cout << "Invalid density.\n"; return; }
+            {
+                std::unique_lock<std::shared_mutex> lock(metalsMutex);
+                metals.setDensity(id, density);
+            }
+            invalidateAssayCaches();
+            saveMetals();
+            std::cout << metals.get(id).name << " updated.\n";
+        }
+        else if (choice == 4) {
+            displayKaratInfo();
+        }
+    }
 
     void manageSettings() {
         clearScreen();
         std::cout << "+-----------------------------+\n|   Settings & Configuration  |\n+-----------------------------+\n";
         std::cout << "  1. Set Currency Symbol (current: \"" << settings.currencySymbol << "\")\n";
         std::cout << "  2. Set Default Weight Unit (current: " << settings.defaultWeightUnit << ")\n";
+        std::cout << "  3. Toggle Binary Log '" << BINARY_LOG_FILENAME << "' (current: " << (settings.binaryLog ? "on" : "off") << ")\n";
         std::cout << "  Choice: ";
         int choice;
         std::cin >> choice;
@@ -344,43 +1774,536 @@ private:
             std::cout << "Enter new default unit (1-5): ";
             std::cin >> settings.defaultWeightUnit;
         }
-        settings.save();
+        else if (choice == 3) {
+            settings.binaryLog = !settings.binaryLog;
+            logWriter.stop();
+            initializeLogFile();
+        }
+        Settings saved = settings;
+        io.submit(CONFIG_FILENAME, [saved]() { return saved.save(); });
+        saveState();
         std::cout << "Settings saved.\n";
     }
 
+    void viewInstrumentation() {
+        std::ostringstream screen;
+        screen << "+----------------------------------+\n|   Performance Instrumentation    |\n+----------------------------------+\n";
+        if (!INSTRUMENTATION_ENABLED) {
+            screen << "Instrumentation is compiled out of this build (GOLDASH_NO_INSTRUMENTATION).\n";
+            presentScreen(screen.str());
+            return;
+        }
+        LatencySnapshot total = snapshotLatencies();
+        LatencySnapshot shown = latenciesSince(total, instrumentationBaseline);
+        screen << "Latency in microseconds since startup or the last reset:\n\n";
+        screen << std::left << std::setw(22) << "Operation" << std::right << std::setw(10) << "Count" << std::setw(11) << "Mean"
+            << std::setw(11) << "p50" << std::setw(11) << "p99" << std::setw(11) << "p99.9" << std::setw(11) << "Max" << "\n";
+        bool any = false;
+        screen << std::fixed << std::setprecision(2);
+        for (size_t op = 0; op < TIMED_OPERATION_COUNT; ++op) {
+            TimedOperation operation = static_cast<TimedOperation>(op);
+            const LatencyHistogram& histogram = shown.get(operation);
+            if (histogram.count == 0) continue;
+            any = true;
+            screen << std::left << std::setw(22) << timedOperationName(operation) << std::right << std::setw(10) << histogram.count
+                << std::setw(11) << shown.meanNanos(operation) / 1000.0 << std::setw(11) << shown.quantileNanos(operation, 0.5) / 1000.0
+                << std::setw(11) << shown.quantileNanos(operation, 0.99) / 1000.0 << std::setw(11) << shown.quantileNanos(operation, 0.999) / 1000.0
+                << std::setw(11) << shown.toNanos(histogram.maxTicks) / 1000.0 << "\n";
+        }
+        if (!any) screen << "(no samples yet)\n";
+
+        AssayCacheStats cacheTotal = assayCacheStats();
+        AssayCacheStats cache = cacheTotal;
+        cache.subtract(assayCacheBaseline);
+        screen << "\nAssay cache: " << cache.hits << " hits, " << cache.misses << " misses (" << std::setprecision(1) << cache.hitRate() * 100.0
+            << "% hit rate), " << cache.evictions << " evictions\n";
+        screen << "  " << cache.entries << " of " << cache.capacity << " entries in use; emptied " << cache.invalidations
+            << " time(s) after density changes\n";
+
+        screen << "\n  1. Reset\n  2. Write Prometheus metrics to '" << METRICS_FILENAME << "'\n  0. Back\n  Choice: ";
+        presentScreen(screen.str());
+        int choice;
+        std::cin >> choice;
+        if (!std::cin.good()) { clearInputBuffer(); return; }
+        if (choice == 1) {
+            instrumentationBaseline = total;
+            assayCacheBaseline = cacheTotal;
+            std::cout << "Counters reset.\n";
+        }
+        else if (choice == 2) {
+            std::ofstream metricsFile(METRICS_FILENAME);
+            if (metricsFile.is_open()) {
+                writePrometheusMetrics(metricsFile, total); // Prometheus expects cumulative counts
+                writeAssayCacheMetrics(metricsFile, cacheTotal);
+                std::cout << "Metrics written.\n";
+            }
+            else {
+                std::cout << "Could not write " << METRICS_FILENAME << ".\n";
+            }
+        }
+    }
+
     void manageGoldPrice() { /* ... unchanged ... */ }
-    void displayKaratInfo() { /* ... unchanged ... */ }
+    // Expected density of every whole karat from 8K to 24K for each registered metal.
+    void displayKaratInfo() {
+        std::vector<KaratDensityTable> tables;
+        tables.reserve(metals.size());
+        for (const Metal& metal : metals.all()) tables.push_back(karatDensityTable(metal));
+
+        std::ostringstream screen;
+        screen << "+-----------------------------+\n|   Karat Density Reference   |\n+-----------------------------+\n";
+        screen << "Expected density (g/cm^3) of gold alloyed with each metal:\n\n";
+        screen << std::left << std::setw(7) << "Karat" << std::right << std::setw(10) << "Purity(%)";
+        for (const Metal& metal : metals.all()) screen << std::setw(12) << metal.name.substr(0, 11);
+        screen << "\n" << std::fixed;
+        for (int karat = TABLE_MAX_KARAT; karat >= TABLE_MIN_KARAT; --karat) {
+            screen << std::left << std::setw(7) << std::to_string(karat) + "K" << std::right << std::setprecision(2) << std::setw(10) << karat * (100.0 / 24.0)
+                << std::setprecision(3);
+            for (const KaratDensityTable& table : tables) screen << std::setw(12) << table.at(karat);
+            screen << "\n";
+        }
+        presentScreen(screen.str());
+    }
 
     void displayHelp() {
-        clearScreen();
-        std::cout << "+------------------------+\n|   Help & Usage Guide   |\n+------------------------+\n\n";
-        std::cout << "--- Features ---\n";
-        std::cout << "1-2. Purity Calculators: Determine purity from weight or density. Now supports stone weight deduction (in Carats).\n\n";
-        std::cout << "3-4. Alloying Calculators: Plan how to create new alloys or improve existing ones.\n\n";
-        std::cout << "5. Investment Calculator: Project the future value of your gold holdings based on different price scenarios.\n\n";
-        std::cout << "--- Data & Logs ---\n";
-        std::cout << "6. View Log: See all past calculations in a CSV file, good for spreadsheets.\n\n";
-        std::cout << "7. Manage Metals: Add or list alloying metals. Saved in 'metals.dat'.\n\n";
-        std::cout << "--- Configuration ---\n";
-        std::cout << "8. Settings: Set your preferred currency symbol and default weight units.\n\n";
-        std::cout << "9. Help & About:\n";
-        std::cout << "   - This screen.\n";
-        std::cout << "   - About: A comprehensive Gold & Alloy Toolkit. Built with C++.\n\n";
-        std::cout << "10. Exit: Closes the program.\n";
+        std::ostringstream screen;
+        screen << "+------------------------+\n|   Help & Usage Guide   |\n+------------------------+\n\n";
+        screen << "--- Features ---\n";
+        screen << "1-2. Purity Calculators: Determine purity from weight or density. Now supports stone weight deduction (in Carats).\n";
+        screen << "   For mixed scrap, enter the impurity as a blend by mass ratio, e.g. Silver:3+Copper:1.\n";
+        screen << "   With balances connected (--balance), the weights in air and in water are read from the\n";
+        screen << "   balance: press Enter once the reading is stable, or type a weight to override it.\n\n";
+        screen << "3-4. Alloying Calculators: Plan how to create new alloys or improve existing ones.\n";
+        screen << "   Whole inventories can be planned at once with --plan-alloy (see Batch Mode).\n\n";
+        screen << "5. Investment Calculator: Project the future value of your gold holdings based on different price scenarios.\n";
+        screen << "   Holdings are saved in 'portfolio.dat' and can be revalued at many prices at once, or swept\n";
+        screen << "   across a grid of prices x 24 karats x weight units for negotiation tables.\n\n";
+        screen << "--- Data & Logs ---\n";
+        screen << "6. View Log: Page through past calculations (newest first), filter by calculation type, or\n";
+        screen << "   follow new entries live. The log itself is a CSV file, good for spreadsheets.\n";
+        screen << "   [s] shows totals for today, this month and recent months instantly: they are kept up to\n";
+        screen << "   date in '" << LOG_SUMMARY_FILENAME << "' as rows are logged (see --rebuild-summary).\n\n";
+        screen << "7. Manage Metals: Add or list alloying metals. Saved in 'metals.dat'. The karat density table\n";
+        screen << "   shows the density expected of each karat from 8K to 24K with every metal.\n\n";
+        screen << "--- Configuration ---\n";
+        screen << "8. Settings: Set your preferred currency symbol and default weight units.\n\n";
+        screen << "9. Help & About:\n";
+        screen << "   - This screen.\n";
+        screen << "   - About: A comprehensive Gold & Alloy Toolkit. Built with C++.\n\n";
+        screen << "10. Performance Instrumentation: Latency percentiles of the calculators, log writes and\n";
+        screen << "   file loads since startup, and how many repeated assays the assay cache answered (it is\n";
+        screen << "   emptied whenever a metal density changes). Can be saved as Prometheus text to '" << METRICS_FILENAME << "';\n";
+        screen << "   the --serve mode also exposes it at GET /metrics.\n\n";
+        screen << "11. Exit: Closes the program.\n\n";
+        screen << "--- Batch Mode ---\n";
+        screen << "Run 'goldash --batch <in.csv> [out.csv] [--unit g|ozt|oz|dwt|tola]' (use '-' for stdin/stdout)\n";
+        screen << "to assay records of impurity,weightInAir,weightInWater,stoneCarats without the menu.\n";
+        screen << "Run 'goldash --export-log <out.csv> [--last N] [--from YYYY-MM-DD] [--to YYYY-MM-DD]' to\n";
+        screen << "convert the binary log (Settings > 3) back to the CSV layout.\n";
+        screen << "Run 'goldash --aggregate <daily.csv> <log.csv|directory>... [--merged <merged.csv>]' to combine\n";
+        screen << "the logs of several stores into daily totals, and optionally into one log in time order.\n";
+        screen << "Run 'goldash --rebuild-summary' to recompute '" << LOG_SUMMARY_FILENAME << "' from the log (it is also\n";
+        screen << "rebuilt automatically whenever it no longer matches the log).\n";
+        screen << "Run 'goldash --plan-alloy <lots.csv> [out.csv] [--optimize] [--stock grams] [--fine-gold-karat K]'\n";
+        screen << "to plan fine gold and alloy additions for lots of tag,massGrams,karat,targetKarat. --optimize\n";
+        screen << "pools lots per target karat into melts to save fine gold; --stock limits the fine gold used.\n";
+        screen << "Run 'goldash --serve [port] [--threads N] [--price-feed <file>]' to share the calculators with\n";
+        screen << "other terminals as JSON over HTTP: POST /purity/weight, /purity/density, /alloy, /valuation\n";
+        screen << "and GET /price, /summary.\n";
+        screen << "Run 'goldash --price-feed <file>' to follow live prices: the last line of the file is the\n";
+        screen << "current price per gram.\n";
+        screen << "Run 'goldash --balance <port>[:baud]' (repeatable, e.g. COM3:9600 or /dev/ttyUSB0) to weigh on\n";
+        screen << "serial balances. A&D, Ohaus, Mettler SICS and plain weight lines are understood; readings are\n";
+        screen << "taken once they settle. The default is " << BALANCE_DEFAULT_BAUD << " baud, 8N1.\n";
+        presentScreen(screen.str());
     }
 
     double getValidatedNumericInput(const std::string& prompt) { /* ... unchanged ... */ return 0.0; }
-    void initializeLogFile() { /* ... unchanged ... */ }
-    void logResult(const std::string& calcType, double purity, double karat, double pureGold, double value) { /* ... unchanged ... */ }
-    void saveGoldPrice() { /* ... unchanged ... */ }
-    void loadGoldPrice() { /* ... unchanged ... */ }
-    void saveMetals() { /* ... unchanged ... */ }
-    void loadMetals() { /* ... unchanged ... */ }
-    void initializeDefaultMetals() { /* ... unchanged ... */ }
+    // The log files themselves are opened by the writer on the first logResult().
+    void initializeLogFile() {
+        logWriter.setBinaryEnabled(settings.binaryLog);
+        logWriter.setSummaryPath(LOG_SUMMARY_FILENAME);
+    }
+
+    void logResult(const std::string& calcType, double purity, double karat, double pureGold, double value) {
+        GOLDASH_TIMED_SCOPE(TimedOperation::LogAppend);
+        LogRecord record;
+        record.timestamp = std::time(nullptr);
+        size_t length = std::min(calcType.size(), sizeof(record.calcType) - 1);
+        calcType.copy(record.calcType, length);
+        record.calcType[length] = '\0';
+        record.purity = purity;
+        record.karat = karat;
+        record.pureGold = pureGold;
+        record.value = value;
+        logWriter.append(record);
+    }
+    double goldPricePerGram() const { return goldPrice.read().pricePerGram; }
+
+    void setGoldPrice(double pricePerGram) {
+        goldPrice.publish(pricePerGram, static_cast<int64_t>(std::time(nullptr)));
+        saveGoldPrice();
+    }
+
+    // Callers hold priceHistoryMutex.
+    PriceHistory& history() {
+        if (!priceHistoryLoaded) {
+            priceHistory.load(PRICE_FILENAME);
+            priceHistoryLoaded = true;
+        }
+        return priceHistory;
+    }
+
+    // Price changes are journaled rather than rewriting the packed state; see loadState().
+    void saveGoldPrice() {
+        PriceSnapshot snapshot = goldPrice.read();
+        std::string currency = settings.currencySymbol;
+        io.submit(PRICE_FILENAME, [this, snapshot, currency]() {
+            std::lock_guard<std::mutex> lock(priceHistoryMutex);
+            bool appended = history().append(snapshot.timestamp, snapshot.pricePerGram, currency);
+            return appendPriceJournal(STATE_JOURNAL_FILENAME, snapshot.pricePerGram, snapshot.timestamp) && appended;
+        });
+    }
+
+    void loadGoldPrice() {
+        std::lock_guard<std::mutex> lock(priceHistoryMutex);
+        PriceHistory& prices = history();
+        goldPrice.publish(prices.latestPrice(), prices.latestTimestamp());
+    }
+
+    bool loadState() {
+        PackedState state;
+        if (!loadPackedState(STATE_FILENAME, state)) return false;
+        bool journaled = replayPriceJournal(STATE_JOURNAL_FILENAME, state);
+        settings = state.settings;
+        metals.clear();
+        for (const Metal& metal : state.metals) metals.add(metal);
+        goldPrice.publish(state.pricePerGram, state.priceTimestamp);
+        if (journaled) saveState(); // compact: fold the journaled price into the state file
+        return true;
+    }
+
+    // Rewrites the packed state atomically; it then holds the current price, so the journal is emptied.
+    // Settings and metals are copied now; the price is read when the write runs, under the lock
+    // feed ticks are journaled with, so no tick is truncated away unsaved.
+    void saveState() {
+        PackedState state;
+        state.settings = settings;
+        state.metals = metals.savedMetals();
+        io.submit(STATE_FILENAME, [this, state]() mutable {
+            std::lock_guard<std::mutex> lock(priceHistoryMutex);
+            PriceSnapshot price = goldPrice.read();
+            state.pricePerGram = price.pricePerGram;
+            state.priceTimestamp = price.timestamp;
+            return savePackedState(STATE_FILENAME, state) && clearPriceJournal(STATE_JOURNAL_FILENAME);
+        });
+    }
+
+    void saveMetals() {
+        std::vector<Metal> saved = metals.savedMetals();
+        io.submit(METALS_FILENAME, [saved]() { return saveMetalsFile(METALS_FILENAME, saved); });
+        saveState();
+    }
+
+    void loadMetals() {
+        metals.clear();
+        loadMetalsFile(METALS_FILENAME, metals);
+    }
+
+    void initializeDefaultMetals() {
+        for (const BuiltinMetal& builtin : BUILTIN_METALS) metals.add(Metal(builtin.name, builtin.density));
+        saveMetals();
+    }
 };
 
-int main() {
+// Parses "YYYY-MM-DD" as local midnight.
+bool parseLocalDate(const std::string& text, std::time_t& time) {
+    std::tm local_tm = {};
+    std::istringstream stream(text);
+    stream >> std::get_time(&local_tm, "%Y-%m-%d");
+    if (stream.fail()) return false;
+    local_tm.tm_isdst = -1;
+    time = std::mktime(&local_tm);
+    return time != static_cast<std::time_t>(-1);
+}
+
+// goldash --export-log <out.csv|-> [--last N] [--from YYYY-MM-DD] [--to YYYY-MM-DD]
+// Converts the binary log back to the CSV layout; --to includes that whole day.
+int runLogExport(int argc, char* argv[]) {
+    BinaryLogReader log;
+    if (!log.open(BINARY_LOG_FILENAME)) {
+        std::cerr << "No readable binary log '" << BINARY_LOG_FILENAME << "'. Enable it under Settings.\n";
+        return 1;
+    }
+
+    std::pair<size_t, size_t> range(0, log.size());
+    std::time_t from = 0, to = 0;
+    bool hasFrom = false, hasTo = false;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--last") range = log.lastEntries(std::strtoull(argv[i + 1], nullptr, 10));
+        else if (option == "--from" && parseLocalDate(argv[i + 1], from)) hasFrom = true;
+        else if (option == "--to" && parseLocalDate(argv[i + 1], to)) hasTo = true;
+        else { std::cerr << "Invalid option: " << option << " " << argv[i + 1] << "\n"; return 1; }
+    }
+    if (hasFrom || hasTo) {
+        int64_t upper = hasTo ? static_cast<int64_t>(to) + 24 * 60 * 60 : std::numeric_limits<int64_t>::max();
+        std::pair<size_t, size_t> dates = log.timeRange(hasFrom ? static_cast<int64_t>(from) : 0, upper);
+        range.first = std::max(range.first, dates.first);
+        range.second = std::max(range.first, std::min(range.second, dates.second));
+    }
+
+    std::string outPath = argv[2];
+    if (outPath == "-") {
+        exportBinaryLogToCsv(log, range.first, range.second, std::cout);
+        return 0;
+    }
+    std::ofstream outFile(outPath);
+    if (!outFile.is_open()) { std::cerr << "Cannot open output file: " << outPath << "\n"; return 1; }
+    exportBinaryLogToCsv(log, range.first, range.second, outFile);
+    return 0;
+}
+
+// goldash --aggregate <daily.csv|-> <log.csv|directory>... [--merged <merged.csv>]
+// Consolidates calculation logs from several stores into daily totals; a directory stands for the
+// .csv files in it. --merged also writes every row of every log as one log in time order.
+int runLogAggregate(int argc, char* argv[]) {
+    std::vector<std::string> inputs;
+    std::string mergedPath;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--merged" && i + 1 < argc) { mergedPath = argv[++i]; continue; }
+        std::error_code error;
+        if (!std::filesystem::is_directory(arg, error)) { inputs.push_back(arg); continue; }
+        std::vector<std::string> logs;
+        for (const auto& entry : std::filesystem::directory_iterator(arg, error)) {
+            if (entry.is_regular_file(error) && entry.path().extension() == ".csv") logs.push_back(entry.path().string());
+        }
+        std::sort(logs.begin(), logs.end());
+        inputs.insert(inputs.end(), logs.begin(), logs.end());
+    }
+    if (inputs.empty()) { std::cerr << "No calculation logs given.\n"; return 1; }
+
+    std::ofstream mergedFile;
+    if (!mergedPath.empty()) {
+        mergedFile.open(mergedPath, std::ios::binary | std::ios::trunc);
+        if (!mergedFile.is_open()) { std::cerr << "Cannot open output file: " << mergedPath << "\n"; return 1; }
+    }
+    std::string outPath = argv[2];
+    std::ofstream outFile;
+    if (outPath != "-") {
+        outFile.open(outPath);
+        if (!outFile.is_open()) { std::cerr << "Cannot open output file: " << outPath << "\n"; return 1; }
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    LogAggregate aggregate = aggregateLogs(inputs, mergedPath.empty() ? nullptr : &mergedFile);
+    writeDailyTotals(outPath == "-" ? std::cout : outFile, aggregate);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    for (const std::string& path : aggregate.unreadableFiles) std::cerr << "Cannot read " << path << ", skipped.\n";
+    std::cerr << std::fixed << std::setprecision(2) << aggregate.rows << " rows from " << aggregate.files - aggregate.unreadableFiles.size()
+        << " log(s), " << aggregate.bytes / (1024.0 * 1024.0) << " MB in " << seconds << " s";
+    if (seconds > 0) std::cerr << " (" << aggregate.bytes / (1024.0 * 1024.0) / seconds << " MB/s)";
+    std::cerr << "; " << aggregate.days.size() << " day(s)";
+    if (aggregate.malformedRows > 0) std::cerr << ", " << aggregate.malformedRows << " malformed row(s) skipped";
+    std::cerr << ".\n";
+    return aggregate.unreadableFiles.empty() ? 0 : 2;
+}
+
+// goldash --rebuild-summary
+// Recomputes the log summary sidecar from the CSV log, e.g. after restoring the log from a backup.
+int runSummaryRebuild() {
+    auto started = std::chrono::steady_clock::now();
+    LogSummary summary;
+    if (!summary.rebuild(LOG_FILENAME)) { std::cerr << "Cannot read " << LOG_FILENAME << ".\n"; return 1; }
+    if (!summary.save(LOG_SUMMARY_FILENAME)) { std::cerr << "Cannot write " << LOG_SUMMARY_FILENAME << ".\n"; return 1; }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    size_t periods = 0;
+    uint64_t rows = 0;
+    for (const LogSummaryRecord& entry : summary.entries()) {
+        if (entry.calcType != static_cast<int32_t>(CalculationType::Unknown)) continue;
+        ++periods;
+        if (entry.period % 100 == 0) rows += entry.count;
+    }
+    std::cout << std::fixed << std::setprecision(2) << "Summarized " << rows << " rows (" << summary.coveredBytes() / (1024.0 * 1024.0)
+        << " MB) into " << periods << " days and months in " << seconds << " s.\n";
+    return 0;
+}
+
+// goldash --plan-alloy <lots.csv> [out.csv] [--optimize] [--stock grams] [--fine-gold-karat K]
+// Lots are "tag,massGrams,karat,targetKarat" records.
+int runAlloyPlan(int argc, char* argv[]) {
+    std::string outPath = "-";
+    bool optimize = false;
+    double stockGrams = std::numeric_limits<double>::infinity();
+    double fineGoldKarat = 24.0;
+    for (int i = 3; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--optimize") optimize = true;
+        else if (option == "--stock" && i + 1 < argc && parseDouble(argv[i + 1], stockGrams) && std::isfinite(stockGrams) && stockGrams >= 0) ++i;
+        else if (option == "--fine-gold-karat" && i + 1 < argc && parseDouble(argv[i + 1], fineGoldKarat)
+            && fineGoldKarat > 0 && fineGoldKarat <= 24) ++i;
+        else if (option.compare(0, 2, "--") != 0) outPath = option;
+        else { std::cerr << "Invalid option: " << option << "\n"; return 1; }
+    }
+
+    std::ifstream inFile(argv[2]);
+    if (!inFile.is_open()) { std::cerr << "Cannot open input file: " << argv[2] << "\n"; return 1; }
+    std::vector<AlloyLot> lots;
+    std::string line;
+    std::string fields[4];
+    size_t lineNumber = 0, rejected = 0;
+    while (std::getline(inFile, line)) {
+        ++lineNumber;
+        size_t count = splitCsvLine(line, fields, 4);
+        if (count == 0 || fields[0].empty() || fields[0][0] == '#') continue;
+        AlloyLot lot = { fields[0], 0.0, 0.0, 0.0 };
+        if (count < 4 || !parseDouble(fields[1], lot.massGrams) || !parseDouble(fields[2], lot.karat) || !parseDouble(fields[3], lot.targetKarat)
+            || !std::isfinite(lot.massGrams) || !std::isfinite(lot.karat) || !std::isfinite(lot.targetKarat) // strtod takes "nan" and "inf"
+            || lot.massGrams <= 0 || lot.karat <= 0 || lot.karat > 24 || lot.targetKarat <= 0 || lot.targetKarat > 24) {
+            if (lineNumber == 1) continue; // header row
+            std::cerr << "Line " << lineNumber << ": malformed lot, skipped.\n";
+            ++rejected;
+            continue;
+        }
+        lots.push_back(lot);
+    }
+
+    std::ofstream outFile;
+    if (outPath != "-") {
+        outFile.open(outPath);
+        if (!outFile.is_open()) { std::cerr << "Cannot open output file: " << outPath << "\n"; return 1; }
+    }
+    std::ostream& out = outPath == "-" ? std::cout : outFile;
+    out << std::fixed;
+
+    double fineGoldUsed = 0.0;
+    if (optimize) {
+        std::vector<size_t> deferred;
+        std::vector<AlloyMelt> melts = planAlloyMelts(lots, fineGoldKarat, stockGrams, deferred);
+        out << "Melt,TargetKarat,Lots,Mass(g),Karat,AddFineGold(g),AddAlloy(g),FinalMass(g)\n";
+        for (size_t i = 0; i < melts.size(); ++i) {
+            const AlloyMelt& melt = melts[i];
+            out << i + 1 << ',' << std::setprecision(2) << melt.targetKarat << ',';
+            for (size_t j = 0; j < melt.lots.size(); ++j) out << (j ? " " : "") << lots[melt.lots[j]].tag;
+            out << ',' << std::setprecision(4) << melt.massGrams << ',' << std::setprecision(2) << melt.goldKaratGrams / melt.massGrams << ','
+                << std::setprecision(4) << melt.addition.fineGoldGrams << ',' << melt.addition.alloyGrams << ','
+                << melt.massGrams + melt.addition.fineGoldGrams + melt.addition.alloyGrams << '\n';
+            fineGoldUsed += melt.addition.fineGoldGrams;
+        }
+        if (!deferred.empty()) {
+            out << "deferred,,";
+            for (size_t j = 0; j < deferred.size(); ++j) out << (j ? " " : "") << lots[deferred[j]].tag;
+            out << ",,,,,\n";
+        }
+        std::cerr << melts.size() << " melt(s), " << deferred.size() << " lot(s) deferred";
+    }
+    else {
+        std::vector<AlloyLotPlan> plans = planAlloyLots(lots, fineGoldKarat, stockGrams);
+        out << "Lot,Mass(g),Karat,TargetKarat,AddFineGold(g),AddAlloy(g),FinalMass(g),Status\n";
+        for (size_t i = 0; i < lots.size(); ++i) {
+            const AlloyLot& lot = lots[i];
+            const AlloyAddition& addition = plans[i].addition;
+            out << lot.tag << ',' << std::setprecision(4) << lot.massGrams << ',' << std::setprecision(2) << lot.karat << ',' << lot.targetKarat << ','
+                << std::setprecision(4) << addition.fineGoldGrams << ',' << addition.alloyGrams << ','
+                << lot.massGrams + addition.fineGoldGrams + addition.alloyGrams << ','
+                << (!addition.reachable ? "unreachable" : plans[i].funded ? "ok" : "short of fine gold") << '\n';
+            if (plans[i].funded) fineGoldUsed += addition.fineGoldGrams;
+        }
+        std::cerr << lots.size() << " lot(s)";
+    }
+    std::cerr << ", " << std::fixed << std::setprecision(2) << fineGoldUsed << " g fine gold used.\n";
+    return rejected == 0 ? 0 : 2;
+}
+
+// goldash --serve [port] [--threads N] [--price-feed file]: runs the JSON service (see App::serve).
+int runService(int argc, char* argv[]) {
+    long port = 8080;
+    size_t threads = workerThreadCount();
+    std::string feedPath;
+    for (int i = 2; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--threads" && i + 1 < argc) threads = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        else if (option == "--price-feed" && i + 1 < argc) feedPath = argv[++i];
+        else if (option.compare(0, 2, "--") != 0) port = std::strtol(option.c_str(), nullptr, 10);
+        else { std::cerr << "Invalid option: " << option << "\n"; return 1; }
+    }
+    if (port <= 0 || port > 65535) { std::cerr << "Invalid port.\n"; return 1; }
+
     App toolkit;
+    if (!feedPath.empty()) toolkit.startPriceFeed(feedPath);
+    return toolkit.serve(static_cast<uint16_t>(port), threads);
+}
+
+// goldash --bench-startup [iterations]: times App construction with and without the packed state.
+int runStartupBenchmark(int iterations) {
+    auto medianStartupMicros = [iterations](bool withoutPackedState) {
+        std::vector<double> micros;
+        for (int i = 0; i < iterations; ++i) {
+            std::error_code error;
+            if (withoutPackedState) std::filesystem::remove(STATE_FILENAME, error);
+            auto started = std::chrono::steady_clock::now();
+            { App toolkit; }
+            micros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count());
+        }
+        std::sort(micros.begin(), micros.end());
+        return micros[micros.size() / 2];
+    };
+
+    { App toolkit; } // make sure the packed state exists
+    double packed = medianStartupMicros(false);
+    double individual = medianStartupMicros(true); // each run rebuilds the packed state
+    std::cout << std::fixed << std::setprecision(1) << "Startup (median of " << iterations << "): packed state "
+        << packed << " us, individual files " << individual << " us\n";
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 3 && std::string(argv[1]) == "--export-log") return runLogExport(argc, argv);
+    if (argc >= 3 && std::string(argv[1]) == "--plan-alloy") return runAlloyPlan(argc, argv);
+    if (argc >= 4 && std::string(argv[1]) == "--aggregate") return runLogAggregate(argc, argv);
+    if (argc >= 2 && std::string(argv[1]) == "--rebuild-summary") return runSummaryRebuild();
+    if (argc >= 2 && std::string(argv[1]) == "--serve") return runService(argc, argv);
+    if (argc >= 2 && std::string(argv[1]) == "--bench-startup") return runStartupBenchmark(argc >= 3 ? std::max(1, std::atoi(argv[2])) : 100);
+
+    if (argc >= 3 && std::string(argv[1]) == "--batch") {
+        std::ios::sync_with_stdio(false);
+        std::string inPath = argv[2];
+        std::string outPath = "-";
+        int weightUnit = 1;
+        for (int i = 3; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--unit" && i + 1 < argc) {
+                weightUnit = parseMassUnit(argv[++i]);
+                if (weightUnit == 0) { std::cerr << "Unknown unit: " << argv[i] << " (use g, ozt, oz, dwt or tola)\n"; return 1; }
+            }
+            else outPath = arg;
+        }
+
+        std::ifstream inFile;
+        if (inPath != "-") {
+            inFile.open(inPath);
+            if (!inFile.is_open()) { std::cerr << "Cannot open input file: " << inPath << "\n"; return 1; }
+        }
+        std::ofstream outFile;
+        if (outPath != "-") {
+            outFile.open(outPath);
+            if (!outFile.is_open()) { std::cerr << "Cannot open output file: " << outPath << "\n"; return 1; }
+        }
+
+        App toolkit;
+        size_t rejected = toolkit.runBatch(inPath == "-" ? std::cin : inFile, outPath == "-" ? std::cout : outFile, weightUnit);
+        return rejected == 0 ? 0 : 2;
+    }
+
+    App toolkit;
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--price-feed") toolkit.startPriceFeed(argv[++i]);
+        else if (arg == "--balance") toolkit.addBalance(argv[++i]);
+    }
+    toolkit.startBalances();
     toolkit.run();
     return 0;
 }
@@ -0,0 +1,184 @@
+#include "bench_harness.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct RegisteredBenchmark {
+    std::string name;
+    BenchFunction function;
+};
+
+std::vector<RegisteredBenchmark>& registry() {
+    static std::vector<RegisteredBenchmark> benchmarks;
+    return benchmarks;
+}
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations;
+    double realNanos;   // per iteration
+    double cpuNanos;    // per iteration
+    double itemsPerSecond;
+    double bytesPerSecond;
+};
+
+const uint64_t MAX_ITERATIONS = 1000000000;
+
+// Grows the iteration count until a run lasts at least minSeconds, the way Google Benchmark does.
+BenchResult runOne(const RegisteredBenchmark& benchmark, double minSeconds) {
+    uint64_t iterations = 1;
+    for (;;) {
+        BenchState state(iterations);
+        benchmark.function(state);
+        if (state.realSeconds >= minSeconds || iterations >= MAX_ITERATIONS) {
+            BenchResult result;
+            result.name = benchmark.name;
+            result.iterations = iterations;
+            result.realNanos = state.realSeconds * 1e9 / static_cast<double>(iterations);
+            result.cpuNanos = state.cpuSeconds * 1e9 / static_cast<double>(iterations);
+            result.itemsPerSecond = state.realSeconds > 0 ? state.itemsProcessed / state.realSeconds : 0.0;
+            result.bytesPerSecond = state.realSeconds > 0 ? state.bytesProcessed / state.realSeconds : 0.0;
+            return result;
+        }
+        double multiplier = state.realSeconds > 0 ? std::min(10.0, 1.4 * minSeconds / state.realSeconds) : 10.0;
+        iterations = std::min(MAX_ITERATIONS, std::max(iterations + 1, static_cast<uint64_t>(iterations * multiplier)));
+    }
+}
+
+void writeJsonString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out << '\\';
+        out << c;
+    }
+    out << '"';
+}
+
+void writeJson(std::ostream& out, const std::vector<BenchResult>& results, const char* executable) {
+    std::time_t now = std::time(nullptr);
+    std::tm local_tm;
+    localtime_s(&local_tm, &now);
+    char date[64];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &local_tm);
+
+    out << "{\n  \"context\": {\n    \"date\": \"" << date << "\",\n    \"executable\": ";
+    writeJsonString(out, executable);
+    out << ",\n    \"num_cpus\": " << std::max(1u, std::thread::hardware_concurrency()) << ",\n"
+#ifdef NDEBUG
+        << "    \"library_build_type\": \"release\"\n";
+#else
+        << "    \"library_build_type\": \"debug\"\n";
+#endif
+    out << "  },\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& result = results[i];
+        out << "    {\n      \"name\": ";
+        writeJsonString(out, result.name);
+        out << ",\n      \"run_name\": ";
+        writeJsonString(out, result.name);
+        out << ",\n      \"run_type\": \"iteration\",\n      \"repetitions\": 1,\n      \"repetition_index\": 0,\n"
+            << "      \"threads\": 1,\n      \"iterations\": " << result.iterations << ",\n"
+            << "      \"real_time\": " << result.realNanos << ",\n      \"cpu_time\": " << result.cpuNanos << ",\n"
+            << "      \"time_unit\": \"ns\"";
+        if (result.itemsPerSecond > 0) out << ",\n      \"items_per_second\": " << result.itemsPerSecond;
+        if (result.bytesPerSecond > 0) out << ",\n      \"bytes_per_second\": " << result.bytesPerSecond;
+        out << "\n    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+void writeConsoleRow(const BenchResult& result) {
+    char rate[48] = "";
+    if (result.itemsPerSecond > 0) std::snprintf(rate, sizeof(rate), "items_per_second=%.4g/s", result.itemsPerSecond);
+    std::printf("%-44s %14.1f ns %14.1f ns %12llu %s\n", result.name.c_str(), result.realNanos, result.cpuNanos,
+        static_cast<unsigned long long>(result.iterations), rate);
+    std::fflush(stdout);
+}
+
+bool readFlag(const std::string& arg, const char* flag, std::string& value) {
+    std::string prefix = std::string(flag) + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) return false;
+    value = arg.substr(prefix.size());
+    return true;
+}
+
+} // namespace
+
+void BenchState::startTimer() {
+    cpuStart = std::clock();
+    realStart = std::chrono::steady_clock::now();
+}
+
+void BenchState::stopTimer() {
+    realSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - realStart).count();
+    cpuSeconds = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+}
+
+void registerBenchmark(const std::string& name, BenchFunction function) {
+    registry().push_back({ name, function });
+}
+
+int runBenchmarks(int argc, char* argv[]) {
+    std::string filter = ".", outPath, format = "console", value;
+    double minSeconds = 0.5;
+    bool listOnly = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (readFlag(arg, "--benchmark_filter", value)) filter = value;
+        else if (readFlag(arg, "--benchmark_min_time", value)) minSeconds = std::max(0.0, std::atof(value.c_str())); // "0.5" or "0.5s"
+        else if (readFlag(arg, "--benchmark_out", value)) outPath = value;
+        else if (readFlag(arg, "--benchmark_format", value) && (value == "console" || value == "json")) format = value;
+        else if (readFlag(arg, "--benchmark_out_format", value) && value == "json") continue;
+        else if (arg == "--benchmark_list_tests" || arg == "--benchmark_list_tests=true") listOnly = true;
+        else {
+            std::cerr << "Unknown option: " << arg << "\n"
+                << "Usage: " << argv[0] << " [--benchmark_filter=<regex>] [--benchmark_min_time=<seconds>]\n"
+                << "       [--benchmark_format=console|json] [--benchmark_out=<file>] [--benchmark_list_tests]\n";
+            return 1;
+        }
+    }
+
+    std::regex pattern;
+    try {
+        pattern = std::regex(filter);
+    }
+    catch (const std::regex_error&) {
+        std::cerr << "Invalid --benchmark_filter: " << filter << "\n";
+        return 1;
+    }
+
+    std::vector<BenchResult> results;
+    bool console = format == "console";
+    if (console && !listOnly) {
+        std::printf("%-44s %17s %17s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+        std::printf("%s\n", std::string(94, '-').c_str());
+    }
+    for (const RegisteredBenchmark& benchmark : registry()) {
+        if (!std::regex_search(benchmark.name, pattern)) continue;
+        if (listOnly) {
+            std::printf("%s\n", benchmark.name.c_str());
+            continue;
+        }
+        results.push_back(runOne(benchmark, minSeconds));
+        if (console) writeConsoleRow(results.back());
+    }
+    if (listOnly) return 0;
+
+    if (!console) writeJson(std::cout, results, argv[0]);
+    if (!outPath.empty()) {
+        std::ofstream out(outPath);
+        if (!out.is_open()) {
+            std::cerr << "Cannot write " << outPath << "\n";
+            return 1;
+        }
+        writeJson(out, results, argv[0]);
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+
+// --- Benchmark Harness ---
+// A small stand-in for Google Benchmark with the same loop shape, the same --benchmark_filter,
+// --benchmark_min_time, --benchmark_format and --benchmark_out flags, and the same JSON schema, so
+// results feed the usual comparison tooling (e.g. compare.py) between releases.
+
+class BenchState {
+public:
+    explicit BenchState(uint64_t iterations) : remaining(iterations), iterationCount(iterations) {}
+
+    // Loop condition: the timer starts on the first call and stops when the iterations run out,
+    // so setup before the loop and cleanup after it are not measured.
+    bool keepRunning() {
+        if (remaining == iterationCount) startTimer();
+        if (remaining > 0) {
+            --remaining;
+            return true;
+        }
+        stopTimer();
+        return false;
+    }
+
+    uint64_t iterations() const { return iterationCount; }
+    void setItemsProcessed(uint64_t items) { itemsProcessed = items; }
+    void setBytesProcessed(uint64_t bytes) { bytesProcessed = bytes; }
+
+    double realSeconds = 0.0;
+    double cpuSeconds = 0.0;
+    uint64_t itemsProcessed = 0;
+    uint64_t bytesProcessed = 0;
+
+private:
+    uint64_t remaining;
+    uint64_t iterationCount;
+    std::chrono::steady_clock::time_point realStart;
+    std::clock_t cpuStart = 0;
+
+    void startTimer();
+    void stopTimer();
+};
+
+// Keeps the compiler from discarding value or the work that produced it.
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    const volatile char* bytes = reinterpret_cast<const volatile char*>(&value);
+    static volatile char sink;
+    sink = *bytes;
+#endif
+}
+
+typedef std::function<void(BenchState&)> BenchFunction;
+
+void registerBenchmark(const std::string& name, BenchFunction function);
+
+// Runs the registered benchmarks matching the command-line filter. Returns the process exit code.
+int runBenchmarks(int argc, char* argv[]);
@@ -0,0 +1,515 @@
+#include "differential.h"
+
+#include "bench_harness.h"
+
+#include "metals.h"
+#include "money.h"
+#include "purity.h"
+#include "valuation.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t DEFAULT_SAMPLES = 1 << 18;
+const size_t FUZZ_METAL_COUNT = 8;
+const size_t HOT_WORKING_SET = 2048; // half the assay cache, so the repeated pass hits
+const size_t MAX_EXAMPLES = 3;       // mismatches printed per path
+const uint64_t KARAT_ROUND_TRIP_ULPS = 8; // times the inversion's condition number, gold / |gold - impurity|
+const size_t SWEEP_HOLDINGS = 64;
+const size_t SWEEP_PRICES = 64;
+
+struct Sample {
+    MetalId impurity;
+    double impurityDensity;
+    double mass;
+    double density;
+    double weightInAir;
+    double weightInWater;
+};
+
+// The three outputs every assay path produces, plus the density the weighing paths derive.
+struct Columns {
+    std::vector<double> purityPercent, karats, pureGoldGrams, density;
+
+    explicit Columns(size_t n = 0) : purityPercent(n), karats(n), pureGoldGrams(n), density(n) {}
+
+    void set(size_t i, const PurityResult& result) {
+        density[i] = result.density;
+        purityPercent[i] = result.purityPercent;
+        karats[i] = result.karats;
+        pureGoldGrams[i] = result.pureGoldGrams;
+    }
+};
+
+struct PathReport {
+    std::string name;
+    std::string unit = "ulp";
+    uint64_t checks = 0;
+    uint64_t mismatches = 0;
+    uint64_t maxError = 0;
+    uint64_t bound = 0;
+    double itemsPerSecond = 0.0;
+    std::vector<std::string> examples;
+};
+
+// Distance in representable doubles; -0 and +0 are one apart so even a sign flip shows. Two NaNs
+// agree whatever their payloads, and a NaN against a number is as far apart as it gets.
+uint64_t ulpDistance(double a, double b) {
+    if (std::isnan(a) || std::isnan(b)) return std::isnan(a) && std::isnan(b) ? 0 : std::numeric_limits<uint64_t>::max();
+    int64_t ia, ib;
+    std::memcpy(&ia, &a, sizeof(a));
+    std::memcpy(&ib, &b, sizeof(b));
+    if (ia < 0) ia = std::numeric_limits<int64_t>::min() - ia - 1;
+    if (ib < 0) ib = std::numeric_limits<int64_t>::min() - ib - 1;
+    return ia >= ib ? static_cast<uint64_t>(ia) - static_cast<uint64_t>(ib) : static_cast<uint64_t>(ib) - static_cast<uint64_t>(ia);
+}
+
+void recordWithin(PathReport& report, uint64_t bound, uint64_t error, const char* field, const Sample& sample, double expected, double actual) {
+    ++report.checks;
+    report.maxError = std::max(report.maxError, error);
+    if (error <= bound) return;
+    ++report.mismatches;
+    if (report.examples.size() >= MAX_EXAMPLES) return;
+    char line[256];
+    std::snprintf(line, sizeof(line), "%s: mass %a density %a impurity %a air %a water %a: expected %a, got %a", field,
+        sample.mass, sample.density, sample.impurityDensity, sample.weightInAir, sample.weightInWater, expected, actual);
+    report.examples.push_back(line);
+}
+
+void record(PathReport& report, uint64_t error, const char* field, const Sample& sample, double expected, double actual) {
+    recordWithin(report, report.bound, error, field, sample, expected, actual);
+}
+
+// order[j] names the sample behind output j; empty means outputs are in sample order.
+void compareColumns(PathReport& report, const std::vector<Sample>& samples, const std::vector<size_t>& order,
+    const Columns& expected, const Columns& actual, bool compareDensity) {
+    for (size_t j = 0; j < actual.karats.size(); ++j) {
+        size_t i = order.empty() ? j : order[j];
+        const Sample& sample = samples[i];
+        record(report, ulpDistance(expected.purityPercent[i], actual.purityPercent[j]), "purity", sample, expected.purityPercent[i], actual.purityPercent[j]);
+        record(report, ulpDistance(expected.karats[i], actual.karats[j]), "karats", sample, expected.karats[i], actual.karats[j]);
+        record(report, ulpDistance(expected.pureGoldGrams[i], actual.pureGoldGrams[j]), "pureGold", sample, expected.pureGoldGrams[i], actual.pureGoldGrams[j]);
+        if (compareDensity) record(report, ulpDistance(expected.density[i], actual.density[j]), "density", sample, expected.density[i], actual.density[j]);
+    }
+}
+
+// Runs body until minSeconds have passed and returns items processed per second.
+template <typename Body>
+double measureThroughput(size_t items, double minSeconds, Body body) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t rounds = 0;
+    double elapsed;
+    do {
+        body();
+        ++rounds;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < minSeconds);
+    return elapsed > 0 ? static_cast<double>(items) * static_cast<double>(rounds) / elapsed : 0.0;
+}
+
+double nudge(double value, int ulps) {
+    for (; ulps > 0; --ulps) value = std::nextafter(value, std::numeric_limits<double>::infinity());
+    for (; ulps < 0; ++ulps) value = std::nextafter(value, -std::numeric_limits<double>::infinity());
+    return value;
+}
+
+// --- Input Generation ---
+
+class SampleGenerator {
+public:
+    SampleGenerator(uint64_t seed, const std::vector<MetalId>& impurities) : random(seed), impurities(impurities) {}
+
+    Sample next() {
+        Sample sample;
+        sample.impurity = impurities[pick(impurities.size())];
+        sample.impurityDensity = metalRegistry().get(sample.impurity).density;
+        sample.mass = randomMass();
+        sample.density = randomDensity(sample.impurityDensity);
+        randomWeighing(sample);
+        return sample;
+    }
+
+private:
+    std::mt19937_64 random;
+    const std::vector<MetalId>& impurities;
+
+    size_t pick(size_t count) { return std::uniform_int_distribution<size_t>(0, count - 1)(random); }
+    double uniform(double low, double high) { return std::uniform_real_distribution<double>(low, high)(random); }
+
+    double special() {
+        const double values[] = { std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity(),
+            -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::denorm_min(), std::numeric_limits<double>::min(),
+            std::numeric_limits<double>::max(), -0.0, 0.0, 1e-300, 1e300 };
+        return values[pick(sizeof(values) / sizeof(values[0]))];
+    }
+
+    double randomMass() {
+        switch (pick(20)) {
+        case 0: return 0.0;
+        case 1: return -uniform(0.0, 50.0);
+        case 2: return special();
+        default: return std::exp(uniform(std::log(0.01), std::log(5000.0)));
+        }
+    }
+
+    double randomDensity(double impurityDensity) {
+        double lower = std::min(PURE_GOLD_DENSITY, impurityDensity), upper = std::max(PURE_GOLD_DENSITY, impurityDensity);
+        switch (pick(10)) {
+        case 5: return uniform(lower - 3 * DENSITY_TOLERANCE, upper + 3 * DENSITY_TOLERANCE);
+        case 6: {
+            // The edges GoldItem branches on, give or take a few ULPs.
+            const double edges[] = { PURE_GOLD_DENSITY, PURE_GOLD_DENSITY - DENSITY_TOLERANCE, PURE_GOLD_DENSITY + DENSITY_TOLERANCE,
+                lower - DENSITY_TOLERANCE, upper + DENSITY_TOLERANCE, impurityDensity };
+            return nudge(edges[pick(sizeof(edges) / sizeof(edges[0]))], static_cast<int>(pick(5)) - 2);
+        }
+        case 7: return uniform(-5.0, 40.0);
+        case 8: return special();
+        default: {
+            double karat = uniform(6.0, 24.0);
+            return karatDensity(karat, impurityDensity) * (1.0 + uniform(-0.002, 0.002));
+        }
+        }
+    }
+
+    void randomWeighing(Sample& sample) {
+        double air = sample.mass;
+        double volume = sample.density > 0 ? air / sample.density : uniform(0.0, 10.0);
+        sample.weightInAir = air;
+        switch (pick(12)) {
+        case 0: sample.weightInWater = 0.0; break;
+        case 1: sample.weightInWater = air; break;
+        case 2: sample.weightInWater = air + uniform(0.0, 1.0); break;
+        case 3: sample.weightInWater = -uniform(0.0, 1.0); break;
+        case 4: sample.weightInWater = special(); break;
+        default: sample.weightInWater = air - volume; break; // water displaces 1 g per cm^3
+        }
+    }
+};
+
+std::vector<MetalId> registerImpurities(uint64_t seed) {
+    MetalRegistry& metals = metalRegistry();
+    std::vector<MetalId> impurities;
+    for (const BuiltinMetal& builtin : BUILTIN_METALS) impurities.push_back(metals.add(Metal(builtin.name, builtin.density)));
+    std::mt19937_64 random(seed ^ 0x5DEECE66DULL);
+    std::uniform_real_distribution<double> density(0.5, 25.0);
+    for (size_t i = 0; i < FUZZ_METAL_COUNT; ++i) {
+        // One impurity as dense as gold, where the purity formula divides by zero at the edges.
+        double value = i == 0 ? PURE_GOLD_DENSITY : density(random);
+        impurities.push_back(metals.add(Metal("Fuzz" + std::to_string(i + 1), value)));
+    }
+    return impurities;
+}
+
+// --- Reference Paths ---
+
+int nearestKaratByScan(const KaratDensityTable& table, double density) {
+    double lowest = std::min(table.density[0], table.density[KARAT_TABLE_SIZE - 1]);
+    double highest = std::max(table.density[0], table.density[KARAT_TABLE_SIZE - 1]);
+    if (!(density >= lowest - DENSITY_TOLERANCE && density <= highest + DENSITY_TOLERANCE)) return 0;
+    size_t best = 0;
+    for (size_t i = 1; i < KARAT_TABLE_SIZE; ++i) {
+        if (std::abs(table.density[i] - density) < std::abs(table.density[best] - density)) best = i;
+    }
+    return TABLE_MIN_KARAT + static_cast<int>(best);
+}
+
+void goldItemFromDensity(const std::vector<Sample>& samples, Columns& out) {
+    for (size_t i = 0; i < samples.size(); ++i) {
+        GoldItem item;
+        item.setImpurity(samples[i].impurity);
+        item.setTotalMass(samples[i].mass);
+        item.setDensity(samples[i].density);
+        out.set(i, { item.getDensity(), item.getPurityPercentage(), item.getKarats(), item.getPureGoldMass() });
+    }
+}
+
+void goldItemFromWeight(const std::vector<Sample>& samples, Columns& out) {
+    for (size_t i = 0; i < samples.size(); ++i) {
+        GoldItem item;
+        item.setImpurity(samples[i].impurity);
+        item.calculateDensityFromWeight(samples[i].weightInAir, samples[i].weightInWater);
+        out.set(i, { item.getDensity(), item.getPurityPercentage(), item.getKarats(), item.getPureGoldMass() });
+    }
+}
+
+// --- Report ---
+
+void printReport(const std::vector<PathReport>& reports) {
+    std::printf("%-32s %12s %11s %12s %12s %14s\n", "Path", "Checks", "Mismatches", "Max error", "Bound", "Items/s");
+    std::printf("%s\n", std::string(98, '-').c_str());
+    for (const PathReport& report : reports) {
+        char maxError[32], bound[32], rate[32] = "-";
+        if (report.checks == 0) std::snprintf(maxError, sizeof(maxError), "-"); // a reference path
+        else if (report.maxError == std::numeric_limits<uint64_t>::max()) std::snprintf(maxError, sizeof(maxError), "nan");
+        else std::snprintf(maxError, sizeof(maxError), "%" PRIu64 " %s", report.maxError, report.unit.c_str());
+        if (report.checks == 0) std::snprintf(bound, sizeof(bound), "-");
+        else std::snprintf(bound, sizeof(bound), "%" PRIu64 " %s", report.bound, report.unit.c_str());
+        if (report.itemsPerSecond > 0) std::snprintf(rate, sizeof(rate), "%.4g", report.itemsPerSecond);
+        std::printf("%-32s %12" PRIu64 " %11" PRIu64 " %12s %12s %14s\n", report.name.c_str(), report.checks, report.mismatches, maxError, bound, rate);
+        for (const std::string& example : report.examples) std::printf("    %s\n", example.c_str());
+    }
+    std::fflush(stdout);
+}
+
+bool writeReportCsv(const std::string& path, const std::vector<PathReport>& reports, uint64_t seed, size_t samples) {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+    out << "Path,Checks,Mismatches,MaxError,Bound,Unit,ItemsPerSecond,Seed,Samples\n";
+    for (const PathReport& report : reports) {
+        out << report.name << ',' << report.checks << ',' << report.mismatches << ',' << report.maxError << ',' << report.bound << ','
+            << report.unit << ',' << report.itemsPerSecond << ',' << seed << ',' << samples << '\n';
+    }
+    return out.good();
+}
+
+bool readFlag(const std::string& arg, const char* flag, std::string& value) {
+    std::string prefix = std::string(flag) + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) return false;
+    value = arg.substr(prefix.size());
+    return true;
+}
+
+} // namespace
+
+int runDifferential(int argc, char* argv[]) {
+    size_t sampleCount = DEFAULT_SAMPLES;
+    uint64_t seed = 1;
+    double minSeconds = 0.2;
+    std::string outPath, value;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--differential") continue;
+        else if (readFlag(arg, "--differential_samples", value)) sampleCount = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+        else if (readFlag(arg, "--differential_seed", value)) seed = std::strtoull(value.c_str(), nullptr, 10);
+        else if (readFlag(arg, "--differential_min_time", value)) minSeconds = std::max(0.0, std::atof(value.c_str()));
+        else if (readFlag(arg, "--differential_out", value)) outPath = value;
+        else {
+            std::cerr << "Unknown option: " << arg << "\n"
+                << "Usage: " << argv[0] << " --differential [--differential_samples=<n>] [--differential_seed=<n>]\n"
+                << "       [--differential_min_time=<seconds>] [--differential_out=<report.csv>]\n";
+            return 1;
+        }
+    }
+
+    std::vector<MetalId> impurities = registerImpurities(seed);
+    SampleGenerator generator(seed, impurities);
+    std::vector<Sample> samples;
+    samples.reserve(sampleCount);
+    for (size_t i = 0; i < sampleCount; ++i) samples.push_back(generator.next());
+    std::printf("Differential check: %zu samples, seed %" PRIu64 ", %zu impurities\n\n", sampleCount, seed, impurities.size());
+
+    std::vector<PathReport> reports;
+    const std::vector<size_t> inOrder;
+    size_t n = samples.size();
+
+    // GoldItem is the reference; its timings are the baseline the other paths are read against.
+    Columns fromDensity(n), fromWeight(n);
+    reports.push_back(PathReport());
+    reports.back().name = "GoldItem (reference)";
+    reports.back().itemsPerSecond = measureThroughput(n, minSeconds, [&]() { goldItemFromDensity(samples, fromDensity); });
+    reports.push_back(PathReport());
+    reports.back().name = "GoldItem/FromWeight (reference)";
+    reports.back().itemsPerSecond = measureThroughput(n, minSeconds, [&]() { goldItemFromWeight(samples, fromWeight); });
+
+    {
+        PathReport report;
+        report.name = "assayFromDensity";
+        Columns out(n);
+        report.itemsPerSecond = measureThroughput(n, minSeconds, [&]() {
+            for (size_t i = 0; i < n; ++i) out.set(i, assayFromDensity(samples[i].mass, samples[i].density, samples[i].impurityDensity));
+        });
+        compareColumns(report, samples, inOrder, fromDensity, out, true);
+        reports.push_back(report);
+    }
+    {
+        PathReport report;
+        report.name = "assayFromWeight";
+        Columns out(n);
+        report.itemsPerSecond = measureThroughput(n, minSeconds, [&]() {
+            for (size_t i = 0; i < n; ++i) out.set(i, assayFromWeight(samples[i].weightInAir, samples[i].weightInWater, samples[i].impurityDensity));
+        });
+        compareColumns(report, samples, inOrder, fromWeight, out, true);
+        reports.push_back(report);
+    }
+
+    // Bulk kernels take columns; an odd count leaves a scalar tail after the SIMD lanes.
+    AssayBatch batch;
+    batch.reserve(n);
+    for (const Sample& sample : samples) batch.add(Mass<Grams>(sample.mass), sample.density, sample.impurityDensity);
+    batch.compute();
+    for (int dispatched = 0; dispatched < 2; ++dispatched) {
+        PathReport report;
+        report.name = dispatched ? "computePurityBulk (dispatched)" : "computePurityScalar";
+        Columns out(n);
+        out.density = batch.density;
+        report.itemsPerSecond = measureThroughput(n, minSeconds, [&]() {
+            if (dispatched) computePurityBulk(n, batch.massGrams.data(), batch.density.data(), batch.impurityDensity.data(),
+                out.purityPercent.data(), out.karats.data(), out.pureGoldGrams.data());
+            else computePurityScalar(0, n, batch.massGrams.data(), batch.density.data(), batch.impurityDensity.data(),
+                out.purityPercent.data(), out.karats.data(), out.pureGoldGrams.data());
+        });
+        compareColumns(report, samples, inOrder, fromDensity, out, false);
+        reports.push_back(report);
+    }
+
+    // Cold: every round starts from empty tables and runs through far more keys than they hold, so
+    // stores and evictions are exercised. Hot: a working set that fits, repeated.
+    {
+        PathReport report;
+        report.name = "cachedAssay (cold)";
+        Columns out(n);
+        report.itemsPerSecond = measureThroughput(n, minSeconds, [&]() {
+            invalidateAssayCaches();
+            for (size_t i = 0; i < n; ++i) out.set(i, cachedAssay(samples[i].mass, samples[i].density, samples[i].impurityDensity));
+        });
+        compareColumns(report, samples, inOrder, fromDensity, out, true);
+        reports.push_back(report);
+    }
+    {
+        PathReport report;
+        report.name = "cachedAssay (hot)";
+        std::vector<size_t> order(n);
+        for (size_t j = 0; j < n; ++j) order[j] = j % std::min(n, HOT_WORKING_SET);
+        Columns out(n);
+        invalidateAssayCaches();
+        AssayCacheStats before = assayCacheStats();
+        report.itemsPerSecond = measureThroughput(n, minSeconds, [&]() {
+            for (size_t j = 0; j < n; ++j) {
+                const Sample& sample = samples[order[j]];
+                out.set(j, cachedAssay(sample.mass, sample.density, sample.impurityDensity));
+            }
+        });
+        AssayCacheStats after = assayCacheStats();
+        after.subtract(before);
+        report.name += " " + std::to_string(static_cast<int>(after.hitRate() * 100.0 + 0.5)) + "% hits";
+        compareColumns(report, samples, order, fromDensity, out, true);
+        reports.push_back(report);
+    }
+    {
+        PathReport report;
+        report.name = "GoldItem::assay";
+        Columns out(n);
+        report.itemsPerSecond = measureThroughput(n, minSeconds, [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                GoldItem item;
+                item.setImpurity(samples[i].impurity);
+                item.setTotalMass(samples[i].mass);
+                item.setDensity(samples[i].density);
+                out.set(i, item.assay());
+            }
+        });
+        compareColumns(report, samples, inOrder, fromDensity, out, true);
+        reports.push_back(report);
+    }
+
+    // Karat tables. With an impurity as dense as gold every karat is equally near, so those are skipped.
+    std::vector<KaratDensityTable> tables(metalRegistry().size());
+    for (MetalId id : impurities) tables[id] = karatDensityTable(metalRegistry().get(id));
+    auto hasKarats = [](double impurityDensity) { return impurityDensity != PURE_GOLD_DENSITY; };
+    {
+        PathReport report;
+        report.name = "nearestTableKarat";
+        report.unit = "karat";
+        std::vector<int> found(n);
+        report.itemsPerSecond = measureThroughput(n, minSeconds, [&]() {
+            for (size_t i = 0; i < n; ++i) found[i] = nearestTableKarat(tables[samples[i].impurity], samples[i].density);
+        });
+        for (size_t i = 0; i < n; ++i) {
+            if (!hasKarats(samples[i].impurityDensity)) continue;
+            int expected = nearestKaratByScan(tables[samples[i].impurity], samples[i].density);
+            record(report, static_cast<uint64_t>(std::abs(found[i] - expected)), "karat", samples[i], expected, found[i]);
+        }
+        reports.push_back(report);
+    }
+    {
+        // A karat's table density assays back to that karat. Inverting the mixing model loses more
+        // bits the closer the impurity is to gold's density, so the bound scales with that. Densities
+        // within DENSITY_TOLERANCE of pure gold are read as pure by design; only 24K is checked there.
+        PathReport report;
+        report.name = "KaratTable round trip";
+        for (MetalId id : impurities) {
+            const KaratDensityTable& table = tables[id];
+            double impurityDensity = metalRegistry().get(id).density;
+            if (!hasKarats(impurityDensity)) continue;
+            double condition = std::max(1.0, PURE_GOLD_DENSITY / std::abs(PURE_GOLD_DENSITY - impurityDensity));
+            uint64_t bound = KARAT_ROUND_TRIP_ULPS * static_cast<uint64_t>(std::ceil(condition));
+            report.bound = std::max(report.bound, bound);
+            for (int karat = TABLE_MIN_KARAT; karat <= TABLE_MAX_KARAT; ++karat) {
+                double density = table.at(karat);
+                Sample sample = { id, impurityDensity, 1.0, density, 0.0, 0.0 };
+                if (karat < TABLE_MAX_KARAT && std::abs(density - PURE_GOLD_DENSITY) < DENSITY_TOLERANCE) continue;
+                GoldItem item;
+                item.setImpurity(id);
+                item.setTotalMass(1.0);
+                item.setDensity(density);
+                recordWithin(report, bound, ulpDistance(static_cast<double>(karat), item.getKarats()), "karats", sample, karat, item.getKarats());
+                ++report.checks; // the lookup itself must agree exactly
+                if (nearestTableKarat(table, density) != karat) {
+                    ++report.mismatches;
+                    if (report.examples.size() < MAX_EXAMPLES) report.examples.push_back("lookup of " + std::to_string(karat) + "K density missed");
+                }
+            }
+        }
+        reports.push_back(report);
+    }
+
+    // Fixed-point sweep cells against rounding each holding's value on its own. The grid scales the
+    // price by the karat first, so a cell may round the other way at a half cent.
+    {
+        PathReport report;
+        report.name = "sweepPriceKaratGrid";
+        report.unit = "cent";
+        report.bound = 1;
+        std::mt19937_64 random(seed ^ 0x2545F4914F6CDD1DULL);
+        Portfolio portfolio;
+        for (size_t h = 0; h < SWEEP_HOLDINGS; ++h) {
+            double mass = std::exp(std::uniform_real_distribution<double>(std::log(0.1), std::log(1000.0))(random));
+            portfolio.holdings.emplace_back(mass, 24.0, "H" + std::to_string(h + 1));
+        }
+        std::vector<double> prices = priceLadder(10.0, 200.0, SWEEP_PRICES);
+        std::vector<int> karats;
+        for (int karat = TABLE_MIN_KARAT; karat <= TABLE_MAX_KARAT; ++karat) karats.push_back(karat);
+        SweepGrid grid;
+        size_t cells = prices.size() * karats.size() * SWEEP_HOLDINGS;
+        report.itemsPerSecond = measureThroughput(cells, minSeconds, [&]() { grid = sweepPriceKaratGrid(portfolio, prices, karats); });
+        for (size_t p = 0; p < prices.size(); ++p) {
+            for (size_t k = 0; k < karats.size(); ++k) {
+                const Money* row = grid.row(p, k);
+                Money total;
+                for (size_t h = 0; h < SWEEP_HOLDINGS; ++h) {
+                    Holding holding(portfolio.holdings[h].massGrams, karats[k]);
+                    Money expected = Money::fromDouble(holding.getPureGoldMass() * prices[p]);
+                    Sample sample = { INVALID_METAL_ID, 0.0, holding.massGrams, 0.0, 0.0, 0.0 };
+                    int64_t difference = row[h].cents() - expected.cents();
+                    record(report, static_cast<uint64_t>(difference < 0 ? -difference : difference), "cents", sample, expected.toDouble(), row[h].toDouble());
+                    total += row[h];
+                }
+                ++report.checks; // the total column is exactly the sum of its cells
+                if (row[SWEEP_HOLDINGS] != total) ++report.mismatches;
+            }
+        }
+        reports.push_back(report);
+    }
+
+    printReport(reports);
+    if (!outPath.empty() && !writeReportCsv(outPath, reports, seed, sampleCount)) {
+        std::cerr << "Cannot write " << outPath << "\n";
+        return 1;
+    }
+    uint64_t failures = 0;
+    for (const PathReport& report : reports) failures += report.mismatches;
+    std::printf("\n%s\n", failures == 0 ? "All paths agree." : "MISMATCHES FOUND.");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// --- Differential Harness ---
+// Checks every fast path of the purity math against the reference GoldItem code on random inputs
+// and times each path in the same run, so an optimization ships with one report that covers both
+// correctness and speed:
+//
+//   goldashbench --differential [--differential_samples=<n>] [--differential_seed=<n>]
+//                [--differential_min_time=<seconds>] [--differential_out=<report.csv>]
+//
+// Inputs mix realistic weighings with boundary densities, degenerate masses and non-finite values.
+// The hot-path, bulk (scalar and SIMD) and cached assays must match GoldItem bit for bit. The karat
+// table lookup must match a linear scan, a karat's table density must assay back to that karat
+// within a few ULPs, and sweep cells must be within a cent of per-holding rounding. The same seed
+// reproduces the same inputs. Returns 1 if any path disagrees.
+int runDifferential(int argc, char* argv[]);
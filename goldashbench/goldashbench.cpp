@@ -0,0 +1,350 @@
+// Benchmarks for the goldashcore hot paths. Run from anywhere: data files are created in a
+// scratch directory under the system temp directory.
+//
+//   goldashbench [--benchmark_filter=<regex>] [--benchmark_out=results.json]
+//   goldashbench --differential [...]   (agreement of the purity fast paths; see differential.h)
+
+#include "bench_harness.h"
+#include "differential.h"
+
+#include "calculation_log.h"
+#include "instrumentation.h"
+#include "metals.h"
+#include "paths.h"
+#include "price.h"
+#include "purity.h"
+#include "state.h"
+#include "valuation.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t INPUT_COUNT = 4096; // power of two; about 200 KB of inputs, cache resident
+const size_t LOG_VIEW_ROWS = 1000000;
+const size_t LOG_VIEW_PAGE_ROWS = 20;
+
+struct WeighingInput {
+    MetalId impurity;
+    double weightInAir;
+    double weightInWater;
+};
+
+// Realistic weighings: 1-50 g items of 8-24 karat gold alloyed with one of the built-in metals.
+const std::vector<WeighingInput>& weighingInputs() {
+    static std::vector<WeighingInput> inputs;
+    if (!inputs.empty()) return inputs;
+    MetalRegistry& metals = metalRegistry();
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> mass(1.0, 50.0), goldFraction(8.0 / 24.0, 1.0);
+    for (size_t i = 0; i < INPUT_COUNT; ++i) {
+        const BuiltinMetal& builtin = BUILTIN_METALS[i % BUILTIN_METAL_COUNT];
+        MetalId impurity = metals.add(Metal(builtin.name, builtin.density));
+        double air = mass(random), gold = goldFraction(random);
+        double volume = air * gold / PURE_GOLD_DENSITY + air * (1.0 - gold) / builtin.density;
+        inputs.push_back({ impurity, air, air - volume }); // water displaces 1 g per cm^3
+    }
+    return inputs;
+}
+
+LogRecord sampleRecord(size_t i) {
+    LogRecord record = {};
+    record.timestamp = static_cast<std::time_t>(1700000000 + i * 60);
+    std::snprintf(record.calcType, sizeof(record.calcType), "%s", calculationTypeName(i % 1000 == 0 ? CalculationType::Alloying : CalculationType::PurityFromWeight));
+    record.purity = 75.0 + static_cast<double>(i % 250) / 10.0;
+    record.karat = record.purity * 0.24;
+    record.pureGold = 10.0;
+    record.value = 650.0;
+    return record;
+}
+
+// --- Purity ---
+
+void benchGoldItem(BenchState& state) {
+    const std::vector<WeighingInput>& inputs = weighingInputs();
+    size_t i = 0;
+    while (state.keepRunning()) {
+        const WeighingInput& input = inputs[i++ & (INPUT_COUNT - 1)];
+        GoldItem item;
+        item.setImpurity(input.impurity);
+        item.calculateDensityFromWeight(input.weightInAir, input.weightInWater);
+        doNotOptimize(item.getPurityPercentage());
+        doNotOptimize(item.getKarats());
+        doNotOptimize(item.getPureGoldMass());
+    }
+    state.setItemsProcessed(state.iterations());
+}
+
+void benchAssayFromWeight(BenchState& state) {
+    const std::vector<WeighingInput>& inputs = weighingInputs();
+    std::vector<double> impurityDensity;
+    for (const WeighingInput& input : inputs) impurityDensity.push_back(metalRegistry().get(input.impurity).density);
+    size_t i = 0;
+    while (state.keepRunning()) {
+        size_t slot = i++ & (INPUT_COUNT - 1);
+        doNotOptimize(assayFromWeight(inputs[slot].weightInAir, inputs[slot].weightInWater, impurityDensity[slot]));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+
+// Hit: the inputs fit in the cache and repeat. Miss: every assay has a fresh mass.
+template <bool Hit>
+void benchCachedAssay(BenchState& state) {
+    const std::vector<WeighingInput>& inputs = weighingInputs();
+    std::vector<double> impurityDensity;
+    for (const WeighingInput& input : inputs) impurityDensity.push_back(metalRegistry().get(input.impurity).density);
+    invalidateAssayCaches();
+    size_t i = 0;
+    while (state.keepRunning()) {
+        size_t slot = i & (INPUT_COUNT - 1);
+        double mass = Hit ? inputs[slot].weightInAir : inputs[slot].weightInAir + static_cast<double>(i) * 1e-9;
+        doNotOptimize(cachedAssay(mass, inputs[slot].weightInAir / (inputs[slot].weightInAir - inputs[slot].weightInWater), impurityDensity[slot]));
+        ++i;
+    }
+    state.setItemsProcessed(state.iterations());
+}
+
+template <bool Dispatched>
+void benchBulkKernel(BenchState& state) {
+    AssayBatch batch;
+    for (const WeighingInput& input : weighingInputs()) {
+        double density = input.weightInAir / (input.weightInAir - input.weightInWater);
+        batch.add(Mass<Grams>(input.weightInAir), density, metalRegistry().get(input.impurity).density);
+    }
+    batch.compute(); // sizes the output columns
+    while (state.keepRunning()) {
+        if (Dispatched) {
+            computePurityBulk(batch.size(), batch.massGrams.data(), batch.density.data(), batch.impurityDensity.data(),
+                batch.purityPercent.data(), batch.karats.data(), batch.pureGoldGrams.data());
+        }
+        else {
+            computePurityScalar(0, batch.size(), batch.massGrams.data(), batch.density.data(), batch.impurityDensity.data(),
+                batch.purityPercent.data(), batch.karats.data(), batch.pureGoldGrams.data());
+        }
+        doNotOptimize(batch.pureGoldGrams[0]);
+    }
+    state.setItemsProcessed(state.iterations() * batch.size());
+}
+
+// --- Instrumentation ---
+
+// Cost of one sample: both counter reads plus the histogram update.
+void benchScopedTimer(BenchState& state) {
+    while (state.keepRunning()) {
+        GOLDASH_TIMED_SCOPE(TimedOperation::BulkAssay);
+    }
+    state.setItemsProcessed(state.iterations());
+}
+
+// --- Logging ---
+
+const size_t LOG_ROWS_PER_ITERATION = 1000;
+
+// The pre-writer logResult(): open the CSV, append one row, close it.
+void benchLogAppendSync(BenchState& state) {
+    std::filesystem::remove(LOG_FILENAME);
+    std::string row;
+    size_t i = 0;
+    while (state.keepRunning()) {
+        for (size_t n = 0; n < LOG_ROWS_PER_ITERATION; ++n) {
+            row.clear();
+            LogWriter::formatRow(sampleRecord(i++), row);
+            std::ofstream logFile(LOG_FILENAME, std::ios::app);
+            logFile << row;
+        }
+    }
+    state.setItemsProcessed(state.iterations() * LOG_ROWS_PER_ITERATION);
+}
+
+// Rows handed to the background writer and flushed to disk, as the app logs today.
+void benchLogAppendAsync(BenchState& state) {
+    std::filesystem::remove(LOG_FILENAME);
+    LogWriter writer(LOG_FILENAME, BINARY_LOG_FILENAME);
+    writer.start();
+    size_t i = 0;
+    while (state.keepRunning()) {
+        for (size_t n = 0; n < LOG_ROWS_PER_ITERATION; ++n) writer.append(sampleRecord(i++));
+        writer.flush();
+    }
+    state.setItemsProcessed(state.iterations() * LOG_ROWS_PER_ITERATION);
+}
+
+// What the caller of logResult() waits for: just the hand-off to the writer.
+void benchLogAppendAsyncCaller(BenchState& state) {
+    std::filesystem::remove(LOG_FILENAME);
+    LogWriter writer(LOG_FILENAME, BINARY_LOG_FILENAME);
+    writer.start();
+    size_t i = 0;
+    while (state.keepRunning()) writer.append(sampleRecord(i++));
+    state.setItemsProcessed(state.iterations());
+    writer.flush();
+}
+
+// --- Startup ---
+
+void prepareStartupFiles() {
+    static bool prepared = false;
+    if (prepared) return;
+    prepared = true;
+
+    Settings settings;
+    settings.currencySymbol = "$";
+    settings.save();
+    MetalRegistry metals;
+    for (const BuiltinMetal& builtin : BUILTIN_METALS) metals.add(Metal(builtin.name, builtin.density));
+    saveMetalsFile(METALS_FILENAME, metals.savedMetals());
+
+    std::filesystem::remove(PRICE_FILENAME);
+    PriceHistory history;
+    history.load(PRICE_FILENAME);
+    for (int day = 0; day < 365; ++day) history.append(1700000000 + day * 86400, 60.0 + day * 0.05, "$");
+
+    PackedState state;
+    state.settings = settings;
+    state.metals = metals.savedMetals();
+    state.pricePerGram = history.latestPrice();
+    state.priceTimestamp = history.latestTimestamp();
+    savePackedState(STATE_FILENAME, state);
+}
+
+// Settings, loadMetals() and loadGoldPrice() from their individual files.
+void benchStartupIndividualFiles(BenchState& state) {
+    prepareStartupFiles();
+    while (state.keepRunning()) {
+        Settings settings;
+        settings.load();
+        MetalRegistry metals;
+        loadMetalsFile(METALS_FILENAME, metals);
+        PriceHistory history;
+        history.load(PRICE_FILENAME);
+        doNotOptimize(history.latestPrice());
+        doNotOptimize(metals.size());
+    }
+}
+
+void benchStartupPackedState(BenchState& state) {
+    prepareStartupFiles();
+    while (state.keepRunning()) {
+        PackedState packed;
+        loadPackedState(STATE_FILENAME, packed);
+        doNotOptimize(packed.pricePerGram);
+    }
+}
+
+// --- Log Viewing ---
+
+const char* const LOG_VIEW_FILENAME = "calculation_log_1m.csv";
+
+void prepareLogViewFile() {
+    static bool prepared = false;
+    if (prepared) return;
+    prepared = true;
+    std::ofstream file(LOG_VIEW_FILENAME, std::ios::binary | std::ios::trunc);
+    std::string rows = std::string(LOG_CSV_HEADER) + "\n";
+    for (size_t i = 0; i < LOG_VIEW_ROWS; ++i) {
+        LogWriter::formatRow(sampleRecord(i), rows);
+        if (rows.size() > (1 << 20)) {
+            file << rows;
+            rows.clear();
+        }
+    }
+    file << rows;
+}
+
+// position: 0 = newest page, 1 = a page from the middle of the file.
+template <int Position, CalculationType Filter>
+void benchLogViewPage(BenchState& state) {
+    prepareLogViewFile();
+    CsvLogPager pager;
+    pager.open(LOG_VIEW_FILENAME);
+    uint64_t end = Position == 0 ? pager.size() : pager.size() / 2;
+    std::vector<std::string> page;
+    while (state.keepRunning()) {
+        page.clear();
+        doNotOptimize(pager.readPageBefore(end, LOG_VIEW_PAGE_ROWS, Filter, page));
+    }
+    state.setItemsProcessed(state.iterations() * LOG_VIEW_PAGE_ROWS);
+}
+
+// --- Valuation ---
+
+const size_t SWEEP_HOLDINGS = 207; // 200 prices x 24 karats x (207 + total) = 10^6 cells
+const size_t SWEEP_PRICES = 200;
+
+Portfolio sweepPortfolio() {
+    Portfolio portfolio;
+    for (size_t i = 0; i < SWEEP_HOLDINGS; ++i) portfolio.holdings.emplace_back(5.0 + static_cast<double>(i % 97), 22.0, "lot" + std::to_string(i));
+    return portfolio;
+}
+
+std::vector<int> sweepKarats() {
+    std::vector<int> karats;
+    for (int karat = 1; karat <= 24; ++karat) karats.push_back(karat);
+    return karats;
+}
+
+void benchSweepGrid(BenchState& state) {
+    Portfolio portfolio = sweepPortfolio();
+    std::vector<double> prices = priceLadder(200.0, 300.0, SWEEP_PRICES);
+    std::vector<int> karats = sweepKarats();
+    size_t cells = 0;
+    while (state.keepRunning()) {
+        SweepGrid grid = sweepPriceKaratGrid(portfolio, prices, karats);
+        cells = grid.values.size();
+        doNotOptimize(grid.values.back());
+    }
+    state.setItemsProcessed(state.iterations() * cells);
+}
+
+void benchSweepCsv(BenchState& state) {
+    Portfolio portfolio = sweepPortfolio();
+    SweepGrid grid = sweepPriceKaratGrid(portfolio, priceLadder(200.0, 300.0, SWEEP_PRICES), sweepKarats());
+    while (state.keepRunning()) {
+        std::ostringstream out;
+        writeSweepCsv(out, portfolio, grid, { 1 });
+        doNotOptimize(out.tellp());
+    }
+    state.setItemsProcessed(state.iterations() * grid.values.size());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::error_code error;
+    std::filesystem::path dataDirectory = std::filesystem::temp_directory_path(error) / "goldashbench";
+    std::filesystem::create_directories(dataDirectory, error);
+    std::filesystem::current_path(dataDirectory, error);
+    if (error) {
+        std::cerr << "Cannot use scratch directory " << dataDirectory.string() << "\n";
+        return 1;
+    }
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]).compare(0, 14, "--differential") == 0) return runDifferential(argc, argv);
+    }
+
+    registerBenchmark("Purity/GoldItem", benchGoldItem);
+    registerBenchmark("Purity/AssayFromWeight", benchAssayFromWeight);
+    registerBenchmark("Purity/CachedAssayHit", benchCachedAssay<true>);
+    registerBenchmark("Purity/CachedAssayMiss", benchCachedAssay<false>);
+    registerBenchmark("Purity/BulkScalar/4096", benchBulkKernel<false>);
+    registerBenchmark("Purity/BulkDispatched/4096", benchBulkKernel<true>);
+    registerBenchmark("Instrumentation/ScopedTimer", benchScopedTimer);
+    registerBenchmark("Log/AppendSync/1000", benchLogAppendSync);
+    registerBenchmark("Log/AppendAsync/1000", benchLogAppendAsync);
+    registerBenchmark("Log/AppendAsyncCaller", benchLogAppendAsyncCaller);
+    registerBenchmark("Startup/IndividualFiles", benchStartupIndividualFiles);
+    registerBenchmark("Startup/PackedState", benchStartupPackedState);
+    registerBenchmark("LogView/NewestPage/1M", benchLogViewPage<0, CalculationType::Unknown>);
+    registerBenchmark("LogView/MiddlePage/1M", benchLogViewPage<1, CalculationType::Unknown>);
+    registerBenchmark("LogView/NewestFilteredPage/1M", benchLogViewPage<0, CalculationType::Alloying>);
+    registerBenchmark("Valuation/SweepGrid/1M", benchSweepGrid);
+    registerBenchmark("Valuation/SweepCsv/1M", benchSweepCsv);
+    return runBenchmarks(argc, argv);
+}
@@ -0,0 +1,95 @@
+#include "alloy.h"
+
+#include "instrumentation.h"
+
+#include <algorithm>
+#include <map>
+
+AlloyAddition planAlloyAddition(double massGrams, double karat, double targetKarat, double fineGoldKarat) {
+    AlloyAddition addition;
+    if (targetKarat > karat) {
+        if (targetKarat >= fineGoldKarat) addition.reachable = false;
+        else addition.fineGoldGrams = massGrams * (targetKarat - karat) / (fineGoldKarat - targetKarat);
+    }
+    else if (targetKarat < karat) {
+        addition.alloyGrams = massGrams * (karat - targetKarat) / targetKarat;
+    }
+    return addition;
+}
+
+std::vector<AlloyLotPlan> planAlloyLots(const std::vector<AlloyLot>& lots, double fineGoldKarat, double stockGrams) {
+    GOLDASH_TIMED_SCOPE(TimedOperation::AlloyPlan);
+    std::vector<AlloyLotPlan> plans;
+    plans.reserve(lots.size());
+    for (const AlloyLot& lot : lots) {
+        AlloyLotPlan plan = { planAlloyAddition(lot.massGrams, lot.karat, lot.targetKarat, fineGoldKarat), false };
+        plan.funded = plan.addition.reachable && plan.addition.fineGoldGrams <= stockGrams;
+        if (plan.funded) stockGrams -= plan.addition.fineGoldGrams;
+        plans.push_back(plan);
+    }
+    return plans;
+}
+
+std::vector<AlloyMelt> planAlloyMelts(const std::vector<AlloyLot>& lots, double fineGoldKarat, double stockGrams,
+    std::vector<size_t>& deferred) {
+    GOLDASH_TIMED_SCOPE(TimedOperation::AlloyPlan);
+    std::vector<AlloyMelt> melts;
+    std::map<double, size_t> meltByTarget;
+    std::vector<double> credit; // fine gold a melt's above-target lots can still stand in for
+    auto include = [&](size_t lotIndex) {
+        const AlloyLot& lot = lots[lotIndex];
+        auto found = meltByTarget.find(lot.targetKarat);
+        if (found == meltByTarget.end()) {
+            found = meltByTarget.emplace(lot.targetKarat, melts.size()).first;
+            melts.emplace_back();
+            melts.back().targetKarat = lot.targetKarat;
+            credit.push_back(0.0);
+        }
+        AlloyMelt& melt = melts[found->second];
+        melt.lots.push_back(lotIndex);
+        melt.massGrams += lot.massGrams;
+        melt.goldKaratGrams += lot.massGrams * lot.karat;
+        return found->second;
+    };
+
+    std::vector<double> need(lots.size());
+    std::vector<size_t> raised;
+    deferred.clear();
+    for (size_t i = 0; i < lots.size(); ++i) {
+        const AlloyLot& lot = lots[i];
+        if (lot.karat >= lot.targetKarat) {
+            size_t melt = include(i);
+            if (lot.targetKarat < fineGoldKarat) credit[melt] += lot.massGrams * (lot.karat - lot.targetKarat) / (fineGoldKarat - lot.targetKarat);
+        }
+        else if (lot.targetKarat >= fineGoldKarat) {
+            deferred.push_back(i);
+        }
+        else {
+            need[i] = lot.massGrams * (lot.targetKarat - lot.karat) / (fineGoldKarat - lot.targetKarat);
+            raised.push_back(i);
+        }
+    }
+
+    std::sort(raised.begin(), raised.end(), [&](size_t a, size_t b) {
+        return need[a] / (lots[a].massGrams + need[a]) < need[b] / (lots[b].massGrams + need[b]);
+    });
+    for (size_t i : raised) {
+        auto found = meltByTarget.find(lots[i].targetKarat);
+        double available = found == meltByTarget.end() ? 0.0 : credit[found->second];
+        double cost = std::max(0.0, need[i] - available);
+        if (cost > stockGrams) {
+            deferred.push_back(i);
+            continue;
+        }
+        stockGrams -= cost;
+        size_t melt = include(i);
+        credit[melt] = std::max(0.0, credit[melt] - need[i]);
+    }
+    std::sort(deferred.begin(), deferred.end());
+
+    for (AlloyMelt& melt : melts) {
+        std::sort(melt.lots.begin(), melt.lots.end());
+        melt.addition = planAlloyAddition(melt.massGrams, melt.goldKaratGrams / melt.massGrams, melt.targetKarat, fineGoldKarat);
+    }
+    return melts;
+}
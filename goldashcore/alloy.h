@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// --- Alloy Planning ---
+// Works out what each lot needs to reach its target karat. Adding g grams of fine gold at karat f
+// to m grams at karat k gives karat t when g = m(t - k) / (f - t); adding a grams of alloy metal
+// gives t when a = m(k - t) / t.
+
+struct AlloyLot {
+    std::string tag;
+    double massGrams;
+    double karat;
+    double targetKarat;
+};
+
+struct AlloyAddition {
+    double fineGoldGrams = 0.0;
+    double alloyGrams = 0.0;
+    bool reachable = true; // false if the target is at or above the fine gold's own karat
+};
+
+AlloyAddition planAlloyAddition(double massGrams, double karat, double targetKarat, double fineGoldKarat);
+
+struct AlloyLotPlan {
+    AlloyAddition addition;
+    bool funded;
+};
+
+// Plans every lot on its own, drawing fine gold from stock in input order.
+std::vector<AlloyLotPlan> planAlloyLots(const std::vector<AlloyLot>& lots, double fineGoldKarat, double stockGrams);
+
+struct AlloyMelt {
+    double targetKarat;
+    std::vector<size_t> lots;
+    double massGrams = 0.0;
+    double goldKaratGrams = 0.0; // sum of mass * karat over the lots
+    AlloyAddition addition;
+};
+
+// Pools the lots for each target karat into one melt, so lots above the target offset the fine
+// gold needed by lots below it. Lots that need no fine gold always go in; the rest are funded from
+// stock greedily, cheapest per gram of finished metal first. Lots that cannot be funded are
+// returned in `deferred`. O(n log n) in the number of lots.
+std::vector<AlloyMelt> planAlloyMelts(const std::vector<AlloyLot>& lots, double fineGoldKarat, double stockGrams,
+    std::vector<size_t>& deferred);
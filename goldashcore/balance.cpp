@@ -0,0 +1,297 @@
+#include "balance.h"
+
+#include "units.h"
+
+#include <cctype>
+#include <charconv>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const int BALANCE_POLL_INTERVAL_MS = 50; // how quickly the reader notices stop()
+#ifdef _WIN32
+const int BALANCE_IDLE_SLEEP_MS = 5;     // between rounds of zero-timeout reads when no port had data
+#endif
+
+const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    return p;
+}
+
+// Grams per unit for a balance's unit symbol, or 0 if it is not a mass.
+double balanceUnitGrams(const std::string& unit) {
+    if (unit.empty() || unit == "g") return 1.0;
+    if (unit == "mg") return 0.001;
+    if (unit == "kg") return 1000.0;
+    if (unit == "ct") return Carats::GRAMS_PER_UNIT;
+    if (unit == "tl") return Tolas::GRAMS_PER_UNIT;
+    int massUnit = parseMassUnit(unit);
+    return massUnit == 0 ? 0.0 : massToGrams(massUnit, 1.0);
+}
+
+#ifndef _WIN32
+bool baudConstant(int baud, speed_t& speed) {
+    switch (baud) {
+    case 1200: speed = B1200; return true;
+    case 2400: speed = B2400; return true;
+    case 4800: speed = B4800; return true;
+    case 9600: speed = B9600; return true;
+    case 19200: speed = B19200; return true;
+    case 38400: speed = B38400; return true;
+    case 57600: speed = B57600; return true;
+    case 115200: speed = B115200; return true;
+    default: return false;
+    }
+}
+#endif
+
+} // namespace
+
+bool parseBalanceLine(const char* line, size_t length, BalanceReading& reading) {
+    reading = BalanceReading();
+    const char* end = line + length;
+    const char* p = skipSpaces(line, end);
+    if (end - p >= 3 && p[2] == ',' && std::isupper(static_cast<unsigned char>(p[0])) && std::isupper(static_cast<unsigned char>(p[1]))) {
+        if (!((p[0] == 'S' && p[1] == 'T') || (p[0] == 'U' && p[1] == 'S'))) return false; // OL overload, QT piece count
+        reading.hasStatus = true;
+        reading.stable = p[0] == 'S';
+        p += 3;
+    }
+    else if (end - p >= 3 && p[0] == 'S' && p[1] == ' ' && (p[2] == 'S' || p[2] == 'D')) {
+        reading.hasStatus = true;
+        reading.stable = p[2] == 'S';
+        p += 3;
+    }
+
+    p = skipSpaces(p, end);
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = *p == '-';
+        p = skipSpaces(p + 1, end); // some balances pad between the sign and the digits
+    }
+    double value;
+    std::from_chars_result parsed = std::from_chars(p, end, value);
+    if (parsed.ec != std::errc() || !std::isfinite(value)) return false;
+    p = skipSpaces(parsed.ptr, end);
+
+    std::string unit;
+    while (p < end && std::isalpha(static_cast<unsigned char>(*p))) unit += static_cast<char>(std::tolower(static_cast<unsigned char>(*p++)));
+    for (; p < end; ++p) {
+        if (*p == '?') {
+            reading.hasStatus = true;
+            reading.stable = false;
+        }
+        else if (*p != ' ' && *p != '\t') return false;
+    }
+    double gramsPerUnit = balanceUnitGrams(unit);
+    if (gramsPerUnit == 0.0) return false;
+    reading.grams = (negative ? -value : value) * gramsPerUnit;
+    return true;
+}
+
+// --- Serial Ports ---
+
+struct BalanceHub::Port {
+    BalanceState state;
+    StabilityDetector detector;
+    std::string pending; // bytes after the last line break
+#ifdef _WIN32
+    HANDLE handle = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+};
+
+BalanceHub::BalanceHub() = default;
+
+BalanceHub::~BalanceHub() {
+    stop();
+    for (std::unique_ptr<Port>& port : ports) disconnect(*port);
+}
+
+bool BalanceHub::addPort(const std::string& portName, int baud, std::string& error) {
+    std::unique_ptr<Port> port(new Port());
+    port->state.port = portName;
+#ifdef _WIN32
+    std::string device = portName.compare(0, 4, "\\\\.\\") == 0 ? portName : "\\\\.\\" + portName; // needed for COM10 and up
+    port->handle = CreateFileA(device.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+    if (port->handle == INVALID_HANDLE_VALUE) { error = "cannot open " + portName; return false; }
+    DCB dcb = {};
+    dcb.DCBlength = sizeof(dcb);
+    COMMTIMEOUTS timeouts = {};
+    timeouts.ReadIntervalTimeout = MAXDWORD; // with zero totals: ReadFile returns at once with what has arrived
+    bool configured = GetCommState(port->handle, &dcb) != 0;
+    if (configured) {
+        dcb.BaudRate = static_cast<DWORD>(baud);
+        dcb.ByteSize = 8;
+        dcb.Parity = NOPARITY;
+        dcb.StopBits = ONESTOPBIT;
+        dcb.fBinary = TRUE;
+        configured = SetCommState(port->handle, &dcb) && SetCommTimeouts(port->handle, &timeouts);
+    }
+    if (!configured) {
+        error = "cannot configure " + portName + " at " + std::to_string(baud) + " baud";
+        disconnect(*port);
+        return false;
+    }
+    PurgeComm(port->handle, PURGE_RXCLEAR);
+#else
+    speed_t speed;
+    if (!baudConstant(baud, speed)) { error = "unsupported baud rate " + std::to_string(baud); return false; }
+    port->fd = ::open(portName.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (port->fd < 0) { error = "cannot open " + portName + ": " + std::strerror(errno); return false; }
+    if (isatty(port->fd)) { // a FIFO or file replaying a capture needs no line settings
+        termios tio;
+        bool configured = tcgetattr(port->fd, &tio) == 0;
+        if (configured) {
+            cfmakeraw(&tio);
+            tio.c_cflag &= ~static_cast<tcflag_t>(PARENB | CSTOPB | CSIZE);
+            tio.c_cflag |= CS8 | CLOCAL | CREAD;
+            configured = cfsetispeed(&tio, speed) == 0 && cfsetospeed(&tio, speed) == 0 && tcsetattr(port->fd, TCSANOW, &tio) == 0;
+        }
+        if (!configured) {
+            error = "cannot configure " + portName + " at " + std::to_string(baud) + " baud";
+            disconnect(*port);
+            return false;
+        }
+        tcflush(port->fd, TCIFLUSH);
+    }
+#endif
+    port->state.connected = true;
+    ports.push_back(std::move(port));
+    return true;
+}
+
+void BalanceHub::start() {
+    if (running || ports.empty()) return;
+    running = true;
+    worker = std::thread(&BalanceHub::readLoop, this);
+}
+
+void BalanceHub::stop() {
+    if (!running) return;
+    running = false;
+    worker.join();
+}
+
+BalanceState BalanceHub::state(size_t balance) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return ports[balance]->state;
+}
+
+BalanceState BalanceHub::waitForReading(size_t balance, uint64_t seenReadings, std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(mutex);
+    const BalanceState& current = ports[balance]->state;
+    changed.wait_for(lock, timeout, [&]() { return current.readings > seenReadings; });
+    return current;
+}
+
+// Splits incoming bytes into lines (balances end them with CR, LF or both) and updates the state.
+void BalanceHub::consume(Port& port, const char* data, size_t length) {
+    bool updated = false;
+    for (size_t i = 0; i < length; ++i) {
+        char c = data[i];
+        if (c != '\r' && c != '\n') {
+            if (port.pending.size() < BALANCE_MAX_LINE_BYTES) port.pending += c;
+            else port.pending.assign(1, '\0'); // poisoned until the next line break
+            continue;
+        }
+        BalanceReading reading;
+        if (!port.pending.empty() && parseBalanceLine(port.pending.data(), port.pending.size(), reading)) {
+            bool accepted = port.detector.add(reading);
+            std::lock_guard<std::mutex> lock(mutex);
+            BalanceState& state = port.state;
+            ++state.readings;
+            state.latest = reading;
+            if (accepted) {
+                ++state.stableSequence;
+                state.stableGrams = port.detector.stableGrams();
+            }
+            state.holding = port.detector.holdingWeight();
+            updated = true;
+        }
+        port.pending.clear();
+    }
+    if (updated) changed.notify_all();
+}
+
+void BalanceHub::disconnect(Port& port) {
+#ifdef _WIN32
+    if (port.handle != INVALID_HANDLE_VALUE) CloseHandle(port.handle);
+    port.handle = INVALID_HANDLE_VALUE;
+#else
+    if (port.fd >= 0) ::close(port.fd);
+    port.fd = -1;
+#endif
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        port.state.connected = false;
+        port.state.holding = false;
+    }
+    changed.notify_all();
+}
+
+#ifdef _WIN32
+// Windows serial handles cannot be waited on together without overlapped I/O, so the reader makes
+// zero-timeout reads on every port and naps briefly only when none of them had data.
+void BalanceHub::readLoop() {
+    char buffer[512];
+    while (running) {
+        bool received = false;
+        for (std::unique_ptr<Port>& port : ports) {
+            if (port->handle == INVALID_HANDLE_VALUE) continue;
+            DWORD count = 0;
+            if (!ReadFile(port->handle, buffer, sizeof(buffer), &count, nullptr)) { disconnect(*port); continue; } // unplugged
+            if (count > 0) {
+                consume(*port, buffer, count);
+                received = true;
+            }
+        }
+        if (!received) std::this_thread::sleep_for(std::chrono::milliseconds(BALANCE_IDLE_SLEEP_MS));
+    }
+}
+#else
+void BalanceHub::readLoop() {
+    char buffer[512];
+    std::vector<pollfd> entries;
+    std::vector<Port*> polled;
+    while (running) {
+        entries.clear();
+        polled.clear();
+        for (std::unique_ptr<Port>& port : ports) {
+            if (port->fd < 0) continue;
+            entries.push_back({ port->fd, POLLIN, 0 });
+            polled.push_back(port.get());
+        }
+        if (entries.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(BALANCE_POLL_INTERVAL_MS));
+            continue;
+        }
+        if (poll(entries.data(), static_cast<nfds_t>(entries.size()), BALANCE_POLL_INTERVAL_MS) <= 0) continue;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].revents == 0) continue;
+            Port& port = *polled[i];
+            ssize_t count;
+            while ((count = ::read(port.fd, buffer, sizeof(buffer))) > 0) consume(port, buffer, static_cast<size_t>(count));
+            bool drained = count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+            if (!drained) disconnect(port); // end of file, or the adapter was unplugged
+        }
+    }
+}
+#endif
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// --- Balance Input ---
+// Hydrostatic balances on RS-232 or USB serial ports print one weight per line, several times a
+// second. A BalanceHub reads every connected balance on one background thread with non-blocking
+// I/O, so a single PC can serve several balances and the UI only ever looks at the latest state.
+// Each line goes through a StabilityDetector; a weight the detector accepts is what the
+// calculators use in place of a typed one.
+
+const int BALANCE_DEFAULT_BAUD = 9600;
+const size_t BALANCE_STABLE_READINGS = 5;            // consecutive readings a balance without a stability flag must hold
+const double BALANCE_STABLE_TOLERANCE_GRAMS = 0.002; // spread allowed within those readings
+const double BALANCE_EMPTY_PAN_GRAMS = 0.05;         // at or below this the pan counts as empty
+const size_t BALANCE_MAX_LINE_BYTES = 128;           // longer lines are noise (wrong baud rate) and dropped
+
+struct BalanceReading {
+    double grams = 0.0;
+    bool hasStatus = false; // the balance reports stability itself
+    bool stable = false;    // its stability flag, when hasStatus
+};
+
+// Parses one line of balance output. Understands A&D/Ohaus "ST,+00012.345  g" (US for unstable),
+// Mettler Toledo SICS "S S      12.345 g" (S D for unstable) and plain "+  12.345 g" lines, where a
+// '?' marks an unstable reading; the unit may be g, mg, kg, ct, ozt, oz, dwt or tola and defaults
+// to grams. Overload, error and piece-count lines are rejected.
+bool parseBalanceLine(const char* line, size_t length, BalanceReading& reading);
+
+// Turns a stream of readings into distinct stable weights. A reading is settled when the balance
+// says so or, for balances without a flag, when the last BALANCE_STABLE_READINGS readings lie
+// within BALANCE_STABLE_TOLERANCE_GRAMS. A settled load on the pan is accepted once; the next
+// weight is only accepted after the reading moves away from it, so moving the item from the pan
+// to the water basket yields two weights.
+class StabilityDetector {
+public:
+    // Returns true when reading completes a new stable weight.
+    bool add(const BalanceReading& reading) {
+        bool settled;
+        if (reading.hasStatus) {
+            settled = reading.stable;
+            run = 0;
+        }
+        else {
+            if (run == 0 || std::max(runMax, reading.grams) - std::min(runMin, reading.grams) > BALANCE_STABLE_TOLERANCE_GRAMS) {
+                runMin = runMax = reading.grams;
+                run = 0;
+            }
+            runMin = std::min(runMin, reading.grams);
+            runMax = std::max(runMax, reading.grams);
+            ++run;
+            settled = run >= BALANCE_STABLE_READINGS;
+        }
+
+        if (holding && std::abs(reading.grams - weight) > BALANCE_STABLE_TOLERANCE_GRAMS) holding = false;
+        if (!settled || holding || reading.grams <= BALANCE_EMPTY_PAN_GRAMS) return false;
+        weight = reading.grams;
+        holding = true;
+        return true;
+    }
+
+    double stableGrams() const { return weight; }
+    bool holdingWeight() const { return holding; } // the accepted weight is still on the pan
+
+private:
+    size_t run = 0;
+    double runMin = 0.0;
+    double runMax = 0.0;
+    double weight = 0.0;
+    bool holding = false;
+};
+
+struct BalanceState {
+    std::string port;
+    bool connected = false;
+    uint64_t readings = 0;       // lines parsed so far
+    BalanceReading latest;
+    uint64_t stableSequence = 0; // stable weights accepted so far; identifies stableGrams
+    double stableGrams = 0.0;
+    bool holding = false;        // stableGrams is still on the pan
+};
+
+class BalanceHub {
+public:
+    BalanceHub();
+    ~BalanceHub();
+
+    BalanceHub(const BalanceHub&) = delete;
+    BalanceHub& operator=(const BalanceHub&) = delete;
+
+    // Opens a serial port ("COM3", "/dev/ttyUSB0") as 8N1 at baud. Ports are added before start().
+    bool addPort(const std::string& port, int baud, std::string& error);
+
+    void start();
+    void stop();
+
+    size_t size() const { return ports.size(); }
+    BalanceState state(size_t balance) const;
+
+    // Waits until balance has parsed more than seenReadings lines, or for timeout, and returns its state.
+    BalanceState waitForReading(size_t balance, uint64_t seenReadings, std::chrono::milliseconds timeout) const;
+
+private:
+    struct Port;
+
+    std::vector<std::unique_ptr<Port>> ports;
+    mutable std::mutex mutex;
+    mutable std::condition_variable changed;
+    std::atomic<bool> running{ false };
+    std::thread worker;
+
+    void readLoop();
+    void consume(Port& port, const char* data, size_t length);
+    void disconnect(Port& port);
+};
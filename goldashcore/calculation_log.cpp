@@ -0,0 +1,211 @@
+#include "calculation_log.h"
+
+#include <charconv>
+
+namespace {
+
+bool parseDigits(const char* text, int count, int64_t& value) {
+    for (int i = 0; i < count; ++i) {
+        if (text[i] < '0' || text[i] > '9') return false;
+        value = value * 10 + (text[i] - '0');
+    }
+    return true;
+}
+
+CalculationType matchCalculationType(const char* text, size_t length) {
+    for (int32_t i = 1; i <= static_cast<int32_t>(CalculationType::Investment); ++i) {
+        CalculationType type = static_cast<CalculationType>(i);
+        const char* name = calculationTypeName(type);
+        if (std::char_traits<char>::length(name) == length && std::equal(text, text + length, name)) return type;
+    }
+    return CalculationType::Unknown;
+}
+
+} // namespace
+
+const char* calculationTypeName(CalculationType type) {
+    switch (type) {
+    case CalculationType::PurityFromWeight: return "PurityFromWeight";
+    case CalculationType::PurityFromDensity: return "PurityFromDensity";
+    case CalculationType::Alloying: return "Alloying";
+    case CalculationType::ReverseAlloying: return "ReverseAlloying";
+    case CalculationType::Investment: return "Investment";
+    default: return "Unknown";
+    }
+}
+
+CalculationType parseCalculationType(const char* name) {
+    for (int32_t i = 1; i <= static_cast<int32_t>(CalculationType::Investment); ++i) {
+        CalculationType type = static_cast<CalculationType>(i);
+        if (std::strcmp(name, calculationTypeName(type)) == 0) return type;
+    }
+    return CalculationType::Unknown;
+}
+
+bool parseCsvTimestampKey(const char* text, size_t length, int64_t& key) {
+    if (length < 19 || text[4] != '-' || text[7] != '-' || text[10] != ' ' || text[13] != ':' || text[16] != ':') return false;
+    key = 0;
+    return parseDigits(text, 4, key) && parseDigits(text + 5, 2, key) && parseDigits(text + 8, 2, key)
+        && parseDigits(text + 11, 2, key) && parseDigits(text + 14, 2, key) && parseDigits(text + 17, 2, key);
+}
+
+bool parseCsvLogRow(const char* line, size_t length, CsvLogRow& row) {
+    const char* end = line + length;
+    const char* fields[6];
+    size_t lengths[6];
+    const char* cursor = line;
+    for (size_t i = 0; i < 6; ++i) {
+        const char* comma = std::find(cursor, end, ',');
+        if (comma == end && i < 5) return false;
+        fields[i] = cursor;
+        lengths[i] = static_cast<size_t>(comma - cursor);
+        cursor = comma == end ? end : comma + 1;
+    }
+    if (!parseCsvTimestampKey(fields[0], lengths[0], row.key)) return false;
+    row.type = matchCalculationType(fields[1], lengths[1]);
+    double value; // logs written before values were exact cents hold any %g number here
+    if (std::from_chars(fields[2], fields[2] + lengths[2], row.purity).ec != std::errc()
+        || std::from_chars(fields[3], fields[3] + lengths[3], row.karat).ec != std::errc()
+        || std::from_chars(fields[4], fields[4] + lengths[4], row.pureGold).ec != std::errc()
+        || std::from_chars(fields[5], fields[5] + lengths[5], value).ec != std::errc()) {
+        return false;
+    }
+    row.value = Money::fromDouble(value);
+    return true;
+}
+
+bool prepareBinaryLog(const std::string& path, int64_t& lastTimestamp) {
+    lastTimestamp = 0;
+    std::error_code error;
+    uintmax_t fileSize = std::filesystem::exists(path, error) ? std::filesystem::file_size(path, error) : 0;
+    if (error) return false;
+
+    if (fileSize == 0) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        BinaryLogHeader header = {};
+        std::memcpy(header.magic, BINARY_LOG_MAGIC, sizeof(header.magic));
+        header.version = BINARY_LOG_VERSION;
+        header.recordSize = sizeof(BinaryLogRecord);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        return out.good();
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    BinaryLogHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, BINARY_LOG_MAGIC, sizeof(header.magic)) != 0
+        || header.version != BINARY_LOG_VERSION || header.recordSize != sizeof(BinaryLogRecord)) {
+        return false;
+    }
+
+    uintmax_t recordCount = (fileSize - sizeof(BinaryLogHeader)) / sizeof(BinaryLogRecord);
+    uintmax_t alignedSize = sizeof(BinaryLogHeader) + recordCount * sizeof(BinaryLogRecord);
+    if (recordCount > 0) {
+        BinaryLogRecord last;
+        in.seekg(static_cast<std::streamoff>(alignedSize - sizeof(BinaryLogRecord)));
+        if (in.read(reinterpret_cast<char*>(&last), sizeof(last))) lastTimestamp = last.timestamp;
+    }
+    in.close();
+    if (alignedSize != fileSize) std::filesystem::resize_file(path, alignedSize, error);
+    return !error;
+}
+
+void exportBinaryLogToCsv(const BinaryLogReader& log, size_t first, size_t last, std::ostream& out) {
+    out << LOG_CSV_HEADER << "\n";
+    char line[160];
+    for (size_t i = first; i < last; ++i) {
+        const BinaryLogRecord& record = log[i];
+        std::time_t timestamp = static_cast<std::time_t>(record.timestamp);
+        std::tm local_tm;
+        localtime_s(&local_tm, &timestamp);
+        size_t length = std::strftime(line, sizeof(line), "%Y-%m-%d %H:%M:%S", &local_tm);
+        length += static_cast<size_t>(std::snprintf(line + length, sizeof(line) - length, ",%s,%g,%g,%g,",
+            calculationTypeName(static_cast<CalculationType>(record.calcType)), record.purity, record.karat, record.pureGold));
+        length += Money::fromDouble(record.value).format(line + length);
+        line[length++] = '\n';
+        out.write(line, static_cast<std::streamsize>(length));
+    }
+}
+
+bool LogSummary::load(const std::string& path, uint64_t logBytes) {
+    clear();
+    std::ifstream in(path, std::ios::binary);
+    LogSummaryHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, LOG_SUMMARY_MAGIC, sizeof(header.magic)) != 0
+        || header.version != LOG_SUMMARY_VERSION || header.recordSize != sizeof(LogSummaryRecord)
+        || header.coveredBytes != logBytes) {
+        return false;
+    }
+    records.resize(static_cast<size_t>(header.recordCount));
+    if (!in.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(LogSummaryRecord)))) {
+        clear();
+        return false;
+    }
+    for (size_t i = 0; i < records.size(); ++i) {
+        slots.emplace(slotKey(records[i].period, static_cast<CalculationType>(records[i].calcType)), i);
+    }
+    savedCount = records.size();
+    covered = logBytes;
+    return true;
+}
+
+bool LogSummary::rebuild(const std::string& logPath) {
+    GOLDASH_TIMED_SCOPE(TimedOperation::LogAggregate);
+    clear();
+    std::error_code error;
+    if (!std::filesystem::exists(logPath, error)) return !error;
+    MappedFile file;
+    if (!file.open(logPath)) return std::filesystem::file_size(logPath, error) == 0 && !error;
+    const char* data = file.data();
+    const char* end = data + file.size();
+    CsvLogRow row;
+    for (const char* line = data; line < end;) {
+        const char* newline = static_cast<const char*>(std::memchr(line, '\n', static_cast<size_t>(end - line)));
+        const char* lineEnd = newline == nullptr ? end : newline;
+        size_t length = static_cast<size_t>(lineEnd - line);
+        if (length > 0 && line[length - 1] == '\r') --length;
+        if (parseCsvLogRow(line, length, row)) add(row);
+        line = lineEnd + 1;
+    }
+    covered = file.size();
+    return true;
+}
+
+bool LogSummary::save(const std::string& path) {
+    std::fstream out;
+    if (savedCount > 0) out.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!out.is_open()) {
+        savedCount = 0;
+        out.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!out.is_open()) return false;
+    }
+
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+    for (size_t index : dirty) {
+        out.seekp(static_cast<std::streamoff>(sizeof(LogSummaryHeader) + index * sizeof(LogSummaryRecord)));
+        out.write(reinterpret_cast<const char*>(&records[index]), sizeof(LogSummaryRecord));
+    }
+    if (records.size() > savedCount) {
+        out.seekp(static_cast<std::streamoff>(sizeof(LogSummaryHeader) + savedCount * sizeof(LogSummaryRecord)));
+        out.write(reinterpret_cast<const char*>(records.data() + savedCount),
+            static_cast<std::streamsize>((records.size() - savedCount) * sizeof(LogSummaryRecord)));
+    }
+
+    // The header goes last: until it is written the old coveredBytes no longer matches the CSV,
+    // so a crash part-way through leaves a sidecar that is rebuilt rather than trusted.
+    LogSummaryHeader header = {};
+    std::memcpy(header.magic, LOG_SUMMARY_MAGIC, sizeof(header.magic));
+    header.version = LOG_SUMMARY_VERSION;
+    header.recordSize = sizeof(LogSummaryRecord);
+    header.coveredBytes = covered;
+    header.recordCount = records.size();
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.flush();
+    if (!out.good()) return false;
+    dirty.clear();
+    savedCount = records.size();
+    return true;
+}
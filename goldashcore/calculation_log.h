@@ -0,0 +1,569 @@
+#pragma once
+
+#include "instrumentation.h"
+#include "mapped_file.h"
+#include "money.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// --- Log Settings ---
+const char* const LOG_CSV_HEADER = "Timestamp,CalculationType,Purity(%),Karat,PureGold(g),MarketValue($)";
+const size_t LOG_FLUSH_BATCH_ROWS = 512;   // write to disk once this many rows are pending...
+const int LOG_FLUSH_INTERVAL_MS = 250;     // ...or when the oldest pending row is this old
+
+// --- Calculation Types ---
+
+enum class CalculationType : int32_t {
+    Unknown = 0,
+    PurityFromWeight = 1,
+    PurityFromDensity = 2,
+    Alloying = 3,
+    ReverseAlloying = 4,
+    Investment = 5
+};
+
+const char* calculationTypeName(CalculationType type);
+
+CalculationType parseCalculationType(const char* name);
+
+// --- CSV Log Rows ---
+
+struct CsvLogRow {
+    int64_t key;        // timestamp as YYYYMMDDhhmmss, local time as logged
+    CalculationType type;
+    double purity;
+    double karat;
+    double pureGold;
+    Money value;
+};
+
+// "YYYY-MM-DD hh:mm:ss" as the sortable integer YYYYMMDDhhmmss.
+bool parseCsvTimestampKey(const char* text, size_t length, int64_t& key);
+
+// Parses the six LOG_CSV_HEADER fields of one row (without its line ending). The header row and
+// anything else unparseable return false.
+bool parseCsvLogRow(const char* line, size_t length, CsvLogRow& row);
+
+// --- Binary Calculation Log ---
+// Optional append-only companion to the CSV log: a 16-byte header followed by fixed-width records.
+// The writer never lets timestamps go backwards, so the record array is sorted and is its own
+// timestamp index: "last N" and date-range queries are a binary search on the mapped file plus the
+// records returned.
+
+const char BINARY_LOG_MAGIC[8] = { 'G', 'D', 'A', 'S', 'H', 'L', 'O', 'G' };
+const uint32_t BINARY_LOG_VERSION = 1;
+
+struct BinaryLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+};
+
+struct BinaryLogRecord {
+    int64_t timestamp;
+    int32_t calcType;
+    int32_t reserved;
+    double purity;
+    double karat;
+    double pureGold;
+    double value;
+};
+
+static_assert(sizeof(BinaryLogHeader) == 16, "binary log header layout changed");
+static_assert(sizeof(BinaryLogRecord) == 48, "binary log record layout changed");
+
+class BinaryLogReader {
+public:
+    bool open(const std::string& path) {
+        records = nullptr;
+        recordCount = 0;
+        if (!file.open(path) || file.size() < sizeof(BinaryLogHeader)) return false;
+        BinaryLogHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, BINARY_LOG_MAGIC, sizeof(header.magic)) != 0
+            || header.version != BINARY_LOG_VERSION || header.recordSize != sizeof(BinaryLogRecord)) {
+            file.close();
+            return false;
+        }
+        records = reinterpret_cast<const BinaryLogRecord*>(file.data() + sizeof(BinaryLogHeader));
+        recordCount = (file.size() - sizeof(BinaryLogHeader)) / sizeof(BinaryLogRecord);
+        return true;
+    }
+
+    size_t size() const { return recordCount; }
+    const BinaryLogRecord& operator[](size_t index) const { return records[index]; }
+
+    // Index of the first record with timestamp >= time.
+    size_t lowerBound(int64_t time) const {
+        const BinaryLogRecord* found = std::lower_bound(records, records + recordCount, time,
+            [](const BinaryLogRecord& record, int64_t t) { return record.timestamp < t; });
+        return static_cast<size_t>(found - records);
+    }
+
+    // Half-open [first, last) index range of the final count records.
+    std::pair<size_t, size_t> lastEntries(size_t count) const {
+        return { recordCount - std::min(count, recordCount), recordCount };
+    }
+
+    // Half-open [first, last) index range of records with from <= timestamp < to.
+    std::pair<size_t, size_t> timeRange(int64_t from, int64_t to) const {
+        size_t first = lowerBound(from);
+        return { first, std::max(first, lowerBound(to)) };
+    }
+
+private:
+    MappedFile file;
+    const BinaryLogRecord* records = nullptr;
+    size_t recordCount = 0;
+};
+
+// Prepares path for appending: writes the header to a new file, trims a torn trailing record left by
+// a crash, and returns the last stored timestamp through lastTimestamp. Returns false if the file
+// exists but is not a compatible binary log.
+bool prepareBinaryLog(const std::string& path, int64_t& lastTimestamp);
+
+// Writes records [first, last) in the CSV log layout.
+void exportBinaryLogToCsv(const BinaryLogReader& log, size_t first, size_t last, std::ostream& out);
+
+// --- Log Summary ---
+// Running per-day and per-month totals of the CSV log, kept in a small sidecar file so summary
+// queries never rescan the log. Every period has one record per calculation type plus one for all
+// types together (calcType Unknown). The header records how many bytes of the CSV the totals
+// cover; a sidecar that does not match the CSV's size (a crash between the two writes, or a log
+// that was edited or replaced) is rebuilt from the log.
+
+const char LOG_SUMMARY_MAGIC[8] = { 'G', 'D', 'A', 'S', 'H', 'S', 'U', 'M' };
+const uint32_t LOG_SUMMARY_VERSION = 2; // 2: value in cents
+
+struct LogSummaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t coveredBytes;
+    uint64_t recordCount;
+};
+
+struct LogSummaryRecord {
+    int32_t period;     // YYYYMMDD for a day, YYYYMM00 for a month
+    int32_t calcType;   // CalculationType; Unknown totals every type
+    uint64_t count;
+    double pureGold;
+    Money value;
+    double minPurity;
+    double maxPurity;
+};
+
+static_assert(sizeof(LogSummaryHeader) == 32, "log summary header layout changed");
+static_assert(sizeof(LogSummaryRecord) == 48, "log summary record layout changed");
+
+inline int32_t summaryMonth(int32_t day) { return day / 100 * 100; }
+
+class LogSummary {
+public:
+    // Loads the sidecar at path; fails unless it covers exactly logBytes of the CSV log.
+    bool load(const std::string& path, uint64_t logBytes);
+
+    // Recomputes every total from the CSV log. A missing log gives an empty summary.
+    bool rebuild(const std::string& logPath);
+
+    // Writes the records changed since the last save, then the header.
+    bool save(const std::string& path);
+
+    void clear() {
+        records.clear();
+        slots.clear();
+        dirty.clear();
+        savedCount = 0;
+        covered = 0;
+    }
+
+    // Four hash lookups, whatever the size of the log.
+    void add(const CsvLogRow& row) {
+        int32_t day = static_cast<int32_t>(row.key / 1000000);
+        addTo(day, CalculationType::Unknown, row);
+        addTo(summaryMonth(day), CalculationType::Unknown, row);
+        if (row.type != CalculationType::Unknown) {
+            addTo(day, row.type, row);
+            addTo(summaryMonth(day), row.type, row);
+        }
+    }
+
+    // Totals of one day or month (see summaryMonth); nullptr if nothing was logged then.
+    const LogSummaryRecord* find(int32_t period, CalculationType type) const {
+        auto found = slots.find(slotKey(period, type));
+        return found == slots.end() ? nullptr : &records[found->second];
+    }
+
+    // In the order the periods were first logged.
+    const std::vector<LogSummaryRecord>& entries() const { return records; }
+
+    uint64_t coveredBytes() const { return covered; }
+    void setCoveredBytes(uint64_t bytes) { covered = bytes; }
+
+private:
+    std::vector<LogSummaryRecord> records;
+    std::unordered_map<int64_t, size_t> slots;
+    std::vector<size_t> dirty;  // indices below savedCount changed since the last save
+    size_t savedCount = 0;      // records already in the sidecar
+    uint64_t covered = 0;
+
+    static int64_t slotKey(int32_t period, CalculationType type) {
+        return static_cast<int64_t>(period) * 256 + static_cast<int64_t>(type);
+    }
+
+    void addTo(int32_t period, CalculationType type, const CsvLogRow& row) {
+        auto slot = slots.emplace(slotKey(period, type), records.size());
+        if (slot.second) records.push_back({ period, static_cast<int32_t>(type), 0, 0.0, Money(), row.purity, row.purity });
+        else if (slot.first->second < savedCount) dirty.push_back(slot.first->second);
+        LogSummaryRecord& totals = records[slot.first->second];
+        ++totals.count;
+        totals.pureGold += row.pureGold;
+        totals.value += row.value;
+        totals.minPurity = std::min(totals.minPurity, row.purity);
+        totals.maxPurity = std::max(totals.maxPurity, row.purity);
+    }
+};
+
+// --- Calculation Log Writer ---
+// Calculators hand rows to a lock-free single-producer/single-consumer ring; a background thread
+// formats them and appends to the CSV in batches, so calculation latency no longer depends on disk
+// latency. The file stays open for the writer's lifetime and everything queued is written before
+// the destructor returns. When enabled, the same rows also go to the binary log, and the writer
+// keeps the log summary current as it writes. Nothing is opened until the first row is appended.
+
+struct LogRecord {
+    std::time_t timestamp;
+    char calcType[32];
+    double purity;
+    double karat;
+    double pureGold;
+    double value;
+};
+
+class LogWriter {
+public:
+    LogWriter(const std::string& path, const std::string& binaryPath, size_t flushBatchRows = LOG_FLUSH_BATCH_ROWS,
+        std::chrono::milliseconds flushInterval = std::chrono::milliseconds(LOG_FLUSH_INTERVAL_MS))
+        : path(path), binaryPath(binaryPath), flushBatchRows(flushBatchRows), flushInterval(flushInterval), ring(RING_CAPACITY) {}
+
+    ~LogWriter() { stop(); }
+
+    LogWriter(const LogWriter&) = delete;
+    LogWriter& operator=(const LogWriter&) = delete;
+
+    // Takes effect the next time the writer starts.
+    void setBinaryEnabled(bool enabled) { writeBinary = enabled; }
+
+    // Sidecar for the running totals (see LogSummary); empty disables it. Takes effect the next
+    // time the writer starts.
+    void setSummaryPath(const std::string& sidecarPath) { summaryPath = sidecarPath; }
+
+    // Creates the file(s) with headers if needed and starts the writer thread.
+    bool start() {
+        if (running) return true;
+        std::ifstream existing(path, std::ios::binary | std::ios::ate);
+        bool needsHeader = !existing.is_open() || existing.tellg() == 0;
+        existing.close();
+
+        file.open(path, std::ios::app);
+        if (!file.is_open()) {
+            openFailed = true;
+            return false;
+        }
+        if (needsHeader) {
+            file << LOG_CSV_HEADER << "\n";
+            file.flush();
+        }
+        if (writeBinary && prepareBinaryLog(binaryPath, lastBinaryTimestamp)) {
+            binaryFile.open(binaryPath, std::ios::binary | std::ios::app);
+        }
+        running = true;
+        worker = std::thread(&LogWriter::writerLoop, this);
+        return true;
+    }
+
+    // Drains the ring, writes the final batch and closes the file.
+    void stop() {
+        if (!running) return;
+        running = false;
+        worker.join();
+        file.close();
+        if (binaryFile.is_open()) binaryFile.close();
+    }
+
+    // Producer side; must only be called from one thread. Spins (yielding) only if the ring is full.
+    void append(const LogRecord& record) {
+        if (!running && (openFailed || !start())) return;
+        size_t h = head.load(std::memory_order_relaxed);
+        while (h - tail.load(std::memory_order_acquire) >= RING_CAPACITY) std::this_thread::yield();
+        ring[h & (RING_CAPACITY - 1)] = record;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    // Appends record to out as one row of the CSV layout (see LOG_CSV_HEADER). The market value is
+    // written as exact cents, so summing the column never drifts.
+    static void formatRow(const LogRecord& record, std::string& out) {
+        std::tm local_tm;
+        localtime_s(&local_tm, &record.timestamp);
+        char line[160];
+        size_t length = std::strftime(line, sizeof(line), "%Y-%m-%d %H:%M:%S", &local_tm);
+        int rest = std::snprintf(line + length, sizeof(line) - length, ",%s,%g,%g,%g,",
+            record.calcType, record.purity, record.karat, record.pureGold);
+        if (rest <= 0 || length + static_cast<size_t>(rest) + Money::MAX_TEXT_LENGTH + 1 > sizeof(line)) return; // calcType is < 32 chars
+        length += static_cast<size_t>(rest);
+        length += Money::fromDouble(record.value).format(line + length);
+        line[length++] = '\n';
+        out.append(line, length);
+    }
+
+    // Totals of every row the writer has taken from the ring. While the writer is not running
+    // they are checked against the CSV first, so rows logged by another process are picked up.
+    LogSummary summary() {
+        std::lock_guard<std::mutex> lock(summaryMutex);
+        if (!summaryLoaded || !running) refreshSummary();
+        return totals;
+    }
+
+    // Blocks until every row appended so far has been written to disk.
+    void flush() {
+        if (!running) return;
+        size_t target = head.load(std::memory_order_relaxed);
+        flushRequested.store(true, std::memory_order_release);
+        while (written.load(std::memory_order_acquire) < target) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+private:
+    static const size_t RING_CAPACITY = 4096; // power of two
+
+    std::string path;
+    std::string binaryPath;
+    std::string summaryPath;
+    bool writeBinary = false;
+    bool openFailed = false;
+    size_t flushBatchRows;
+    std::chrono::milliseconds flushInterval;
+    std::vector<LogRecord> ring;
+    alignas(64) std::atomic<size_t> head{ 0 };
+    alignas(64) std::atomic<size_t> tail{ 0 };
+    std::atomic<size_t> written{ 0 };
+    std::atomic<bool> running{ false };
+    std::atomic<bool> flushRequested{ false };
+    std::thread worker;
+    std::ofstream file;
+    std::ofstream binaryFile;
+    int64_t lastBinaryTimestamp = 0;
+    std::mutex summaryMutex; // guards totals; held by the writer while it adds a batch
+    LogSummary totals;
+    bool summaryLoaded = false;
+
+    uint64_t logFileSize() const {
+        std::error_code error;
+        uintmax_t size = std::filesystem::file_size(path, error);
+        return error ? 0 : static_cast<uint64_t>(size);
+    }
+
+    // Caller holds summaryMutex. Keeps the totals in memory while they cover the whole CSV, else
+    // loads the sidecar, else rebuilds from the CSV and rewrites the sidecar.
+    void refreshSummary() {
+        uint64_t logBytes = logFileSize();
+        if (summaryLoaded && totals.coveredBytes() == logBytes) return;
+        if (!totals.load(summaryPath, logBytes)) {
+            totals.rebuild(path);
+            if (!summaryPath.empty()) totals.save(summaryPath);
+        }
+        summaryLoaded = true;
+    }
+
+    // The row is parsed back from its CSV text, so running totals match a rebuild exactly.
+    void addToSummary(const char* row, size_t length) {
+        CsvLogRow parsed;
+        if (parseCsvLogRow(row, length, parsed)) totals.add(parsed);
+    }
+
+    // Timestamps are clamped so the binary log stays sorted even if the clock steps backwards.
+    void appendBinary(const LogRecord& record, std::vector<BinaryLogRecord>& out) {
+        BinaryLogRecord binary = {};
+        binary.timestamp = std::max(static_cast<int64_t>(record.timestamp), lastBinaryTimestamp);
+        binary.calcType = static_cast<int32_t>(parseCalculationType(record.calcType));
+        binary.purity = record.purity;
+        binary.karat = record.karat;
+        binary.pureGold = record.pureGold;
+        binary.value = record.value;
+        lastBinaryTimestamp = binary.timestamp;
+        out.push_back(binary);
+    }
+
+    void writerLoop() {
+        std::string pending;
+        std::vector<BinaryLogRecord> pendingBinary;
+        size_t pendingRows = 0;
+        auto lastFlush = std::chrono::steady_clock::now();
+        bool trackSummary = !summaryPath.empty();
+        if (trackSummary) {
+            // On the writer thread, so a rebuild after a crash never delays the calculators.
+            std::lock_guard<std::mutex> lock(summaryMutex);
+            refreshSummary();
+        }
+        for (;;) {
+            bool stopping = !running.load(std::memory_order_acquire);
+            size_t t = tail.load(std::memory_order_relaxed);
+            size_t h = head.load(std::memory_order_acquire);
+            if (t != h) {
+                std::unique_lock<std::mutex> summaryLock(summaryMutex, std::defer_lock);
+                if (trackSummary) summaryLock.lock();
+                for (; t != h; ++t, ++pendingRows) {
+                    const LogRecord& record = ring[t & (RING_CAPACITY - 1)];
+                    size_t rowStart = pending.size();
+                    formatRow(record, pending);
+                    if (trackSummary && pending.size() > rowStart) addToSummary(pending.data() + rowStart, pending.size() - rowStart - 1);
+                    if (binaryFile.is_open()) appendBinary(record, pendingBinary);
+                }
+            }
+            tail.store(t, std::memory_order_release);
+
+            auto now = std::chrono::steady_clock::now();
+            bool forced = flushRequested.exchange(false, std::memory_order_acq_rel);
+            if (pendingRows > 0 && (stopping || forced || pendingRows >= flushBatchRows || now - lastFlush >= flushInterval)) {
+                GOLDASH_TIMED_SCOPE(TimedOperation::LogWrite);
+                file.write(pending.data(), static_cast<std::streamsize>(pending.size()));
+                file.flush();
+                if (binaryFile.is_open()) {
+                    binaryFile.write(reinterpret_cast<const char*>(pendingBinary.data()),
+                        static_cast<std::streamsize>(pendingBinary.size() * sizeof(BinaryLogRecord)));
+                    binaryFile.flush();
+                    pendingBinary.clear();
+                }
+                if (trackSummary) {
+                    std::lock_guard<std::mutex> summaryLock(summaryMutex);
+                    totals.setCoveredBytes(logFileSize());
+                    totals.save(summaryPath);
+                }
+                pending.clear();
+                pendingRows = 0;
+                lastFlush = now;
+                written.store(t, std::memory_order_release);
+            }
+            if (stopping) break;
+            if (t == head.load(std::memory_order_acquire)) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+};
+
+// --- CSV Log Paging ---
+// Reads calculation_log.csv backwards from a byte offset in fixed-size chunks, so showing a page
+// costs the same whatever the size of the log.
+
+class CsvLogPager {
+public:
+    static const size_t CHUNK_SIZE = 64 * 1024;
+
+    bool open(const std::string& path) {
+        file.close();
+        file.clear();
+        file.open(path, std::ios::binary);
+        return file.is_open();
+    }
+
+    uint64_t size() {
+        file.clear();
+        file.seekg(0, std::ios::end);
+        return static_cast<uint64_t>(file.tellg());
+    }
+
+    // Collects up to count data rows that end at or before byte offset end and pass the filter
+    // (filter == Unknown shows every row). Rows are returned oldest first. Returns the offset of
+    // the earliest row collected, which is where the next older page ends; 0 means no older rows.
+    uint64_t readPageBefore(uint64_t end, size_t count, CalculationType filter, std::vector<std::string>& page) {
+        GOLDASH_TIMED_SCOPE(TimedOperation::LogPage);
+        std::vector<std::string> newestFirst;
+        std::string carry;
+        uint64_t pos = end;
+        while (newestFirst.size() < count && pos > 0) {
+            uint64_t chunkStart = pos > CHUNK_SIZE ? pos - CHUNK_SIZE : 0;
+            std::string buffer(static_cast<size_t>(pos - chunkStart), '\0');
+            file.clear();
+            file.seekg(static_cast<std::streamoff>(chunkStart));
+            file.read(&buffer[0], static_cast<std::streamsize>(buffer.size()));
+            buffer += carry;
+
+            size_t lineEnd = buffer.size();
+            for (;;) {
+                size_t newline = lineEnd == 0 ? std::string::npos : buffer.rfind('\n', lineEnd - 1);
+                if (newline == std::string::npos && chunkStart > 0) {
+                    carry.assign(buffer, 0, lineEnd);
+                    break;
+                }
+                size_t lineStart = newline == std::string::npos ? 0 : newline + 1;
+                if (acceptRow(buffer, lineStart, lineEnd, filter)) {
+                    size_t length = lineEnd - lineStart;
+                    if (length > 0 && buffer[lineEnd - 1] == '\r') --length;
+                    newestFirst.emplace_back(buffer, lineStart, length);
+                    if (newestFirst.size() == count) {
+                        pos = chunkStart + lineStart;
+                        break;
+                    }
+                }
+                if (newline == std::string::npos) {
+                    pos = 0;
+                    break;
+                }
+                lineEnd = newline;
+            }
+            if (newestFirst.size() < count && pos > 0) pos = chunkStart;
+        }
+        page.assign(newestFirst.rbegin(), newestFirst.rend());
+        return pos;
+    }
+
+    // Appends complete rows in [begin, end) that pass the filter; returns the offset just past the
+    // last complete row, so a partially written row is picked up by the next call.
+    uint64_t readRowsAfter(uint64_t begin, uint64_t end, CalculationType filter, std::vector<std::string>& rows) {
+        if (end <= begin) return begin;
+        std::string buffer(static_cast<size_t>(end - begin), '\0');
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(begin));
+        file.read(&buffer[0], static_cast<std::streamsize>(buffer.size()));
+
+        size_t lineStart = 0;
+        for (size_t newline = buffer.find('\n'); newline != std::string::npos; newline = buffer.find('\n', lineStart)) {
+            if (acceptRow(buffer, lineStart, newline, filter)) {
+                size_t length = newline - lineStart;
+                if (length > 0 && buffer[newline - 1] == '\r') --length;
+                rows.emplace_back(buffer, lineStart, length);
+            }
+            lineStart = newline + 1;
+        }
+        return begin + lineStart;
+    }
+
+private:
+    std::ifstream file;
+
+    static bool acceptRow(const std::string& buffer, size_t begin, size_t end, CalculationType filter) {
+        if (end <= begin || (end - begin == 1 && buffer[begin] == '\r')) return false;
+        if (buffer.compare(begin, 10, "Timestamp,") == 0) return false; // header row
+        if (filter == CalculationType::Unknown) return true;
+        size_t typeStart = buffer.find(',', begin);
+        if (typeStart == std::string::npos || typeStart >= end) return false;
+        ++typeStart;
+        size_t typeEnd = buffer.find(',', typeStart);
+        if (typeEnd == std::string::npos || typeEnd > end) typeEnd = end;
+        const char* name = calculationTypeName(filter);
+        return buffer.compare(typeStart, typeEnd - typeStart, name) == 0;
+    }
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+
+// --- Durable Writes ---
+// Rewriting a file in place truncates it first, so a crash or power cut mid-save leaves it empty or
+// half written. writeFileAtomically writes a sibling "<path>.tmp", flushes it to the disk and
+// renames it over path, so a reader finds either the old contents or the new ones. appendDurably
+// flushes an append before returning; a torn append can only damage the tail, which the readers
+// of append-only files drop.
+
+bool writeFileAtomically(const std::string& path, const std::string& bytes);
+
+bool appendDurably(const std::string& path, const std::string& bytes);
@@ -0,0 +1,192 @@
+#include "instrumentation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// One thread's histograms. Only the owning thread writes; snapshots read concurrently, so the
+// counters are atomics updated with relaxed load + store (a plain add on x86, no lock prefix).
+struct ThreadLatencies {
+    std::atomic<uint64_t> counts[TIMED_OPERATION_COUNT][LATENCY_BUCKET_COUNT];
+    std::atomic<uint64_t> totalTicks[TIMED_OPERATION_COUNT];
+    std::atomic<uint64_t> maxTicks[TIMED_OPERATION_COUNT];
+    bool inUse;
+};
+
+// Blocks are never freed: a thread that exits hands its block (and its samples) to the next new
+// thread, so totals survive short-lived worker threads.
+struct LatencyRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadLatencies>> blocks;
+};
+
+LatencyRegistry& latencyRegistry() {
+    static LatencyRegistry registry;
+    return registry;
+}
+
+thread_local ThreadLatencies* threadLatencies = nullptr;
+
+struct ThreadLatenciesRelease {
+    ~ThreadLatenciesRelease() {
+        if (threadLatencies == nullptr) return;
+        std::lock_guard<std::mutex> lock(latencyRegistry().mutex);
+        threadLatencies->inUse = false;
+        threadLatencies = nullptr;
+    }
+};
+
+ThreadLatencies* claimThreadLatencies() {
+    thread_local ThreadLatenciesRelease release; // registers the release at thread exit
+    LatencyRegistry& registry = latencyRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const std::unique_ptr<ThreadLatencies>& block : registry.blocks) {
+        if (!block->inUse) {
+            block->inUse = true;
+            return threadLatencies = block.get();
+        }
+    }
+    registry.blocks.emplace_back(new ThreadLatencies()); // value-initialized: all counters zero
+    registry.blocks.back()->inUse = true;
+    return threadLatencies = registry.blocks.back().get();
+}
+
+inline void increment(std::atomic<uint64_t>& counter, uint64_t amount) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// Ticks are converted using the tick rate observed between process start and the snapshot.
+struct TickCalibration {
+    uint64_t ticks;
+    std::chrono::steady_clock::time_point time;
+};
+
+const TickCalibration PROCESS_START = { readCycleCounter(), std::chrono::steady_clock::now() };
+
+double measureNanosPerTick() {
+#if GOLDASH_HAS_CYCLE_COUNTER
+    const auto MIN_CALIBRATION = std::chrono::milliseconds(10);
+    auto elapsed = std::chrono::steady_clock::now() - PROCESS_START.time;
+    if (elapsed < MIN_CALIBRATION) std::this_thread::sleep_for(MIN_CALIBRATION - elapsed);
+    uint64_t ticks = readCycleCounter();
+    auto time = std::chrono::steady_clock::now();
+    if (ticks <= PROCESS_START.ticks) return 1.0;
+    return std::chrono::duration<double, std::nano>(time - PROCESS_START.time).count() / static_cast<double>(ticks - PROCESS_START.ticks);
+#else
+    return 1.0;
+#endif
+}
+
+} // namespace
+
+const char* timedOperationName(TimedOperation operation) {
+    switch (operation) {
+    case TimedOperation::PurityFromWeight: return "purity_from_weight";
+    case TimedOperation::PurityFromDensity: return "purity_from_density";
+    case TimedOperation::Investment: return "investment";
+    case TimedOperation::Scenarios: return "scenarios";
+    case TimedOperation::BulkAssay: return "bulk_assay";
+    case TimedOperation::AlloyPlan: return "alloy_plan";
+    case TimedOperation::ServicePurity: return "service_purity";
+    case TimedOperation::ServiceAlloy: return "service_alloy";
+    case TimedOperation::ServiceValuation: return "service_valuation";
+    case TimedOperation::ServicePrice: return "service_price";
+    case TimedOperation::LogAppend: return "log_append";
+    case TimedOperation::LogWrite: return "log_write";
+    case TimedOperation::LogPage: return "log_page";
+    case TimedOperation::LogAggregate: return "log_aggregate";
+    case TimedOperation::LoadSettings: return "load_settings";
+    case TimedOperation::LoadMetals: return "load_metals";
+    case TimedOperation::LoadPriceHistory: return "load_price_history";
+    case TimedOperation::LoadState: return "load_state";
+    case TimedOperation::SaveState: return "save_state";
+    default: return "unknown";
+    }
+}
+
+void recordLatency(TimedOperation operation, uint64_t ticks) {
+    ThreadLatencies* block = threadLatencies;
+    if (block == nullptr) block = claimThreadLatencies();
+    size_t index = static_cast<size_t>(operation);
+    increment(block->counts[index][latencyBucket(ticks)], 1);
+    increment(block->totalTicks[index], ticks);
+    if (ticks > block->maxTicks[index].load(std::memory_order_relaxed)) block->maxTicks[index].store(ticks, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::quantileTicks(double q) const {
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(count)));
+    rank = std::max<uint64_t>(1, std::min(rank, count));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < LATENCY_BUCKET_COUNT; ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank) return std::min(latencyBucketUpperBound(bucket), maxTicks);
+    }
+    return maxTicks;
+}
+
+// The max of the difference is not recorded, so it is bounded by the highest non-empty bucket.
+void LatencyHistogram::subtract(const LatencyHistogram& earlier) {
+    uint64_t highest = 0;
+    for (size_t bucket = 0; bucket < LATENCY_BUCKET_COUNT; ++bucket) {
+        counts[bucket] -= std::min(counts[bucket], earlier.counts[bucket]);
+        if (counts[bucket] > 0) highest = latencyBucketUpperBound(bucket);
+    }
+    count -= std::min(count, earlier.count);
+    totalTicks -= std::min(totalTicks, earlier.totalTicks);
+    maxTicks = count == 0 ? 0 : std::min(maxTicks, highest);
+}
+
+double LatencySnapshot::meanNanos(TimedOperation operation) const {
+    const LatencyHistogram& histogram = get(operation);
+    return histogram.count == 0 ? 0.0 : toNanos(histogram.totalTicks) / static_cast<double>(histogram.count);
+}
+
+LatencySnapshot snapshotLatencies() {
+    LatencySnapshot snapshot;
+    snapshot.nanosPerTick = measureNanosPerTick();
+    LatencyRegistry& registry = latencyRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const std::unique_ptr<ThreadLatencies>& block : registry.blocks) {
+        for (size_t op = 0; op < TIMED_OPERATION_COUNT; ++op) {
+            LatencyHistogram& histogram = snapshot.operations[op];
+            for (size_t bucket = 0; bucket < LATENCY_BUCKET_COUNT; ++bucket) {
+                uint64_t samples = block->counts[op][bucket].load(std::memory_order_relaxed);
+                histogram.counts[bucket] += samples;
+                histogram.count += samples;
+            }
+            histogram.totalTicks += block->totalTicks[op].load(std::memory_order_relaxed);
+            histogram.maxTicks = std::max(histogram.maxTicks, block->maxTicks[op].load(std::memory_order_relaxed));
+        }
+    }
+    return snapshot;
+}
+
+LatencySnapshot latenciesSince(const LatencySnapshot& later, const LatencySnapshot& earlier) {
+    LatencySnapshot difference = later;
+    for (size_t op = 0; op < TIMED_OPERATION_COUNT; ++op) difference.operations[op].subtract(earlier.operations[op]);
+    return difference;
+}
+
+void writePrometheusMetrics(std::ostream& out, const LatencySnapshot& snapshot) {
+    const double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+    const char* const METRIC = "goldash_operation_duration_seconds";
+    out << "# HELP " << METRIC << " Time spent in instrumented goldash operations.\n";
+    out << "# TYPE " << METRIC << " summary\n";
+    for (size_t op = 0; op < TIMED_OPERATION_COUNT; ++op) {
+        TimedOperation operation = static_cast<TimedOperation>(op);
+        const LatencyHistogram& histogram = snapshot.get(operation);
+        if (histogram.count == 0) continue;
+        const char* name = timedOperationName(operation);
+        for (double q : QUANTILES) {
+            out << METRIC << "{operation=\"" << name << "\",quantile=\"" << q << "\"} " << snapshot.quantileNanos(operation, q) * 1e-9 << "\n";
+        }
+        out << METRIC << "_sum{operation=\"" << name << "\"} " << snapshot.toNanos(histogram.totalTicks) * 1e-9 << "\n";
+        out << METRIC << "_count{operation=\"" << name << "\"} " << histogram.count << "\n";
+    }
+}
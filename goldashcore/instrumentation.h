@@ -0,0 +1,162 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#if defined(_M_X64) || defined(__x86_64__)
+#ifndef _MSC_VER
+#include <x86intrin.h>
+#endif
+#define GOLDASH_HAS_CYCLE_COUNTER 1
+#endif
+
+// --- Instrumentation ---
+// Scoped timers feed per-operation latency histograms kept per thread, so recording a sample
+// takes no lock and shares no cache line with other threads. Snapshots merge every thread's
+// histograms. Define GOLDASH_NO_INSTRUMENTATION to compile the timers out entirely.
+
+enum class TimedOperation : uint8_t {
+    PurityFromWeight,
+    PurityFromDensity,
+    Investment,
+    Scenarios,
+    BulkAssay,
+    AlloyPlan,
+    ServicePurity,
+    ServiceAlloy,
+    ServiceValuation,
+    ServicePrice,
+    LogAppend,
+    LogWrite,
+    LogPage,
+    LogAggregate,
+    LoadSettings,
+    LoadMetals,
+    LoadPriceHistory,
+    LoadState,
+    SaveState,
+    Count
+};
+
+const size_t TIMED_OPERATION_COUNT = static_cast<size_t>(TimedOperation::Count);
+
+#ifdef GOLDASH_NO_INSTRUMENTATION
+const bool INSTRUMENTATION_ENABLED = false;
+#else
+const bool INSTRUMENTATION_ENABLED = true;
+#endif
+
+// snake_case, usable both in the menu and as a Prometheus label value.
+const char* timedOperationName(TimedOperation operation);
+
+// Raw timestamp in ticks: the TSC on x86-64, steady_clock nanoseconds elsewhere. Ticks are only
+// converted to time when a snapshot is taken.
+inline uint64_t readCycleCounter() {
+#if GOLDASH_HAS_CYCLE_COUNTER
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+void recordLatency(TimedOperation operation, uint64_t ticks);
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(TimedOperation op) : operation(op), started(readCycleCounter()) {}
+    ~ScopedTimer() { recordLatency(operation, readCycleCounter() - started); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    TimedOperation operation;
+    uint64_t started;
+};
+
+#define GOLDASH_TIMER_NAME_(line) goldashScopedTimer##line
+#define GOLDASH_TIMER_NAME(line) GOLDASH_TIMER_NAME_(line)
+#ifdef GOLDASH_NO_INSTRUMENTATION
+#define GOLDASH_TIMED_SCOPE(operation) ((void)0)
+#else
+// Times the rest of the enclosing scope as one sample of operation.
+#define GOLDASH_TIMED_SCOPE(operation) ScopedTimer GOLDASH_TIMER_NAME(__LINE__)(operation)
+#endif
+
+// --- Latency Histograms ---
+// HDR-style log-linear buckets: values below 16 ticks are exact, and every power-of-two range
+// above is split into 16 sub-buckets, so any recorded value is known to within 1/16 (6.25%).
+
+const int LATENCY_SUB_BUCKET_BITS = 4;
+const size_t LATENCY_SUB_BUCKETS = size_t(1) << LATENCY_SUB_BUCKET_BITS;
+const int LATENCY_MAX_BIT = 43; // samples are clamped to 2^44 ticks (an hour or more)
+const size_t LATENCY_BUCKET_COUNT = (LATENCY_MAX_BIT - LATENCY_SUB_BUCKET_BITS + 2) * LATENCY_SUB_BUCKETS;
+
+inline int highestBit(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32))) return static_cast<int>(index) + 32;
+    _BitScanReverse(&index, static_cast<unsigned long>(value));
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+inline size_t latencyBucket(uint64_t ticks) {
+    if (ticks < LATENCY_SUB_BUCKETS) return static_cast<size_t>(ticks);
+    int bit = highestBit(ticks);
+    if (bit > LATENCY_MAX_BIT) return LATENCY_BUCKET_COUNT - 1;
+    int shift = bit - LATENCY_SUB_BUCKET_BITS;
+    return static_cast<size_t>(shift + 1) * LATENCY_SUB_BUCKETS + static_cast<size_t>((ticks >> shift) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+// Largest tick count that falls in bucket.
+inline uint64_t latencyBucketUpperBound(size_t bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) return bucket;
+    int shift = static_cast<int>(bucket / LATENCY_SUB_BUCKETS) - 1;
+    uint64_t lowest = (LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS) << shift;
+    return lowest + (uint64_t(1) << shift) - 1;
+}
+
+struct LatencyHistogram {
+    std::array<uint64_t, LATENCY_BUCKET_COUNT> counts{};
+    uint64_t count = 0;
+    uint64_t totalTicks = 0;
+    uint64_t maxTicks = 0;
+
+    // Ticks at or below which a fraction q of the samples fall (bucket upper bound, capped at the max).
+    uint64_t quantileTicks(double q) const;
+    void subtract(const LatencyHistogram& earlier);
+};
+
+struct LatencySnapshot {
+    std::vector<LatencyHistogram> operations = std::vector<LatencyHistogram>(TIMED_OPERATION_COUNT); // ~5 KB each
+    double nanosPerTick = 1.0;
+
+    const LatencyHistogram& get(TimedOperation operation) const { return operations[static_cast<size_t>(operation)]; }
+    double toNanos(uint64_t ticks) const { return static_cast<double>(ticks) * nanosPerTick; }
+    double meanNanos(TimedOperation operation) const;
+    double quantileNanos(TimedOperation operation, double q) const { return toNanos(get(operation).quantileTicks(q)); }
+};
+
+// Merges every thread's histograms recorded since startup. Safe to call while other threads record.
+LatencySnapshot snapshotLatencies();
+
+// Samples recorded between earlier and later (both from snapshotLatencies).
+LatencySnapshot latenciesSince(const LatencySnapshot& later, const LatencySnapshot& earlier);
+
+// Prometheus text exposition format: one summary per operation that has samples.
+void writePrometheusMetrics(std::ostream& out, const LatencySnapshot& snapshot);
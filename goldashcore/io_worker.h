@@ -0,0 +1,103 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// --- Background I/O ---
+// Saves run on one I/O thread, in the order they were queued, so the menu never waits on a slow
+// disk or network share. A task works on copies taken when it was queued (settings, metals,
+// holdings), never on members the UI thread keeps changing. submit() returns a future for callers
+// that need the outcome; failures are also kept for the UI to report on its next screen. The thread
+// starts with the first task, and everything queued is finished before stop() returns.
+
+class IoWorker {
+public:
+    IoWorker() = default;
+    ~IoWorker() { stop(); }
+
+    IoWorker(const IoWorker&) = delete;
+    IoWorker& operator=(const IoWorker&) = delete;
+
+    // Queues task, which returns whether it succeeded; what names it in failure reports.
+    std::future<bool> submit(const std::string& what, std::function<bool()> task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(Job{ what, std::move(task), std::promise<bool>() });
+        std::future<bool> done = jobs.back().done.get_future();
+        ++unfinished;
+        if (!worker.joinable()) {
+            stopping = false;
+            worker = std::thread(&IoWorker::workLoop, this);
+        }
+        changed.notify_all();
+        return done;
+    }
+
+    // Tasks queued or running.
+    size_t pending() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return unfinished;
+    }
+
+    // Names of the tasks that failed since the last call, oldest first.
+    std::vector<std::string> takeFailures() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::string> taken;
+        taken.swap(failures);
+        return taken;
+    }
+
+    // Blocks until every task queued so far has finished.
+    void drain() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this]() { return unfinished == 0; });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!worker.joinable()) return;
+            stopping = true;
+            changed.notify_all();
+        }
+        worker.join();
+    }
+
+private:
+    struct Job {
+        std::string what;
+        std::function<bool()> task;
+        std::promise<bool> done;
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable changed; // a job was queued or finished, or stop() was called
+    std::deque<Job> jobs;
+    size_t unfinished = 0;
+    std::vector<std::string> failures;
+    bool stopping = false;
+    std::thread worker;
+
+    void workLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            changed.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (jobs.empty()) return; // stopping, and nothing left to write
+            Job job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            bool succeeded = job.task();
+            job.done.set_value(succeeded);
+            lock.lock();
+            if (!succeeded) failures.push_back(job.what);
+            --unfinished;
+            changed.notify_all();
+        }
+    }
+};
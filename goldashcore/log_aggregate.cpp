@@ -0,0 +1,248 @@
+#include "log_aggregate.h"
+
+#include "instrumentation.h"
+#include "mapped_file.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <queue>
+
+namespace {
+
+size_t lineLength(const char* line, const char* end) {
+    const char* newline = static_cast<const char*>(std::memchr(line, '\n', static_cast<size_t>(end - line)));
+    return static_cast<size_t>((newline == nullptr ? end : newline) - line);
+}
+
+size_t trimmedLength(const char* line, size_t length) { return length > 0 && line[length - 1] == '\r' ? length - 1 : length; }
+
+bool isHeaderRow(const char* line, size_t length) {
+    size_t headerLength = std::char_traits<char>::length(LOG_CSV_HEADER);
+    return length == headerLength && std::equal(line, line + length, LOG_CSV_HEADER);
+}
+
+struct Segment {
+    size_t file;
+    size_t begin;
+    size_t end;
+    std::map<int32_t, DailyTotals> days;
+    uint64_t rows = 0;
+    uint64_t malformedRows = 0;
+    int64_t firstKey = 0;
+    int64_t lastKey = 0;
+    bool sorted = true;
+};
+
+void aggregateSegment(const MappedFile& file, Segment& segment) {
+    const char* data = file.data();
+    const char* end = data + segment.end;
+    DailyTotals* current = nullptr;
+    for (const char* line = data + segment.begin; line < end;) {
+        size_t length = lineLength(line, end);
+        size_t content = trimmedLength(line, length);
+        CsvLogRow row;
+        if (content > 0 && parseCsvLogRow(line, content, row)) {
+            int32_t day = static_cast<int32_t>(row.key / 1000000);
+            if (current == nullptr || current->day != day) {
+                current = &segment.days[day];
+                current->day = day;
+            }
+            ++current->rows;
+            ++current->typeCounts[static_cast<size_t>(row.type)];
+            if (row.type == CalculationType::PurityFromWeight || row.type == CalculationType::PurityFromDensity) {
+                current->assayedPureGoldGrams += row.pureGold;
+                current->assayedValue += row.value;
+            }
+            if (segment.rows == 0) segment.firstKey = row.key;
+            else if (row.key < segment.lastKey) segment.sorted = false;
+            segment.lastKey = row.key;
+            ++segment.rows;
+        }
+        else if (content > 0 && !isHeaderRow(line, content)) {
+            ++segment.malformedRows;
+        }
+        line += length + 1;
+    }
+}
+
+// Walks one mapped file's data rows in time order: straight through when the file is sorted,
+// otherwise through an index of (key, offset) built once and stable-sorted. In a file without
+// malformed rows every line with a timestamp is a data row, so only the timestamp is parsed.
+class MergeCursor {
+public:
+    MergeCursor(const MappedFile& mapped, bool sorted, bool clean) : file(mapped), validateRows(!clean) {
+        if (!sorted) {
+            for (const char* line = file.data(), *end = line + file.size(); line < end;) {
+                size_t length = lineLength(line, end);
+                int64_t rowKey;
+                if (isDataRow(line, trimmedLength(line, length), rowKey)) index.emplace_back(rowKey, static_cast<size_t>(line - file.data()));
+                line += length + 1;
+            }
+            std::stable_sort(index.begin(), index.end(),
+                [](const std::pair<int64_t, size_t>& a, const std::pair<int64_t, size_t>& b) { return a.first < b.first; });
+            useIndex = true;
+        }
+    }
+
+    // Moves to the next data row; false at the end of the file.
+    bool next() {
+        const char* end = file.data() + file.size();
+        if (useIndex) {
+            if (indexPosition == index.size()) return false;
+            key = index[indexPosition].first;
+            row = file.data() + index[indexPosition++].second;
+            rowLength = trimmedLength(row, lineLength(row, end));
+            return true;
+        }
+        while (offset < file.size()) {
+            const char* line = file.data() + offset;
+            size_t length = lineLength(line, end);
+            offset += length + 1;
+            size_t content = trimmedLength(line, length);
+            if (isDataRow(line, content, key)) {
+                row = line;
+                rowLength = content;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int64_t key = 0;
+    const char* row = nullptr;
+    size_t rowLength = 0;
+
+private:
+    const MappedFile& file;
+    bool validateRows;
+    std::vector<std::pair<int64_t, size_t>> index;
+    size_t indexPosition = 0;
+    size_t offset = 0;
+    bool useIndex = false;
+
+    bool isDataRow(const char* line, size_t length, int64_t& rowKey) const {
+        if (!validateRows) return parseCsvTimestampKey(line, length, rowKey);
+        CsvLogRow parsed;
+        if (!parseCsvLogRow(line, length, parsed)) return false;
+        rowKey = parsed.key;
+        return true;
+    }
+};
+
+uint64_t mergeLogs(const std::vector<std::unique_ptr<MappedFile>>& files, const std::vector<bool>& sorted,
+    const std::vector<bool>& clean, std::ostream& out) {
+    const size_t OUTPUT_BUFFER_BYTES = 1 << 20;
+    std::vector<std::unique_ptr<MergeCursor>> cursors;
+    typedef std::pair<int64_t, size_t> HeapEntry; // (key, cursor); ties go to the earlier input
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+    for (size_t i = 0; i < files.size(); ++i) {
+        cursors.emplace_back(files[i] ? new MergeCursor(*files[i], sorted[i], clean[i]) : nullptr);
+        if (cursors.back() && cursors.back()->next()) heap.emplace(cursors.back()->key, i);
+    }
+
+    std::string buffer = std::string(LOG_CSV_HEADER) + "\n";
+    buffer.reserve(OUTPUT_BUFFER_BYTES + 256);
+    uint64_t rows = 0;
+    while (!heap.empty()) {
+        size_t i = heap.top().second;
+        heap.pop();
+        MergeCursor& cursor = *cursors[i];
+        buffer.append(cursor.row, cursor.rowLength);
+        buffer += '\n';
+        ++rows;
+        if (buffer.size() >= OUTPUT_BUFFER_BYTES) {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+        if (cursor.next()) heap.emplace(cursor.key, i);
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return rows;
+}
+
+} // namespace
+
+LogAggregate aggregateLogs(const std::vector<std::string>& paths, std::ostream* merged) {
+    GOLDASH_TIMED_SCOPE(TimedOperation::LogAggregate);
+    LogAggregate aggregate;
+    aggregate.files = paths.size();
+    std::vector<std::unique_ptr<MappedFile>> files(paths.size());
+    std::vector<Segment> segments;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        files[i].reset(new MappedFile());
+        if (!files[i]->open(paths[i])) {
+            std::error_code error;
+            if (!std::filesystem::is_regular_file(paths[i], error) || std::filesystem::file_size(paths[i], error) != 0) {
+                aggregate.unreadableFiles.push_back(paths[i]);
+            }
+            files[i].reset();
+            continue;
+        }
+        const MappedFile& file = *files[i];
+        aggregate.bytes += file.size();
+        for (size_t begin = 0; begin < file.size();) {
+            size_t end = std::min(file.size(), begin + LOG_AGGREGATE_SEGMENT_BYTES);
+            if (end < file.size()) end += lineLength(file.data() + end, file.data() + file.size()) + 1;
+            end = std::min(end, file.size());
+            Segment segment;
+            segment.file = i;
+            segment.begin = begin;
+            segment.end = end;
+            segments.push_back(std::move(segment));
+            begin = end;
+        }
+    }
+
+    parallelForChunks(segments.size(), 1, [&](size_t, size_t begin, size_t) {
+        aggregateSegment(*files[segments[begin].file], segments[begin]);
+    });
+
+    // Segments are in file order, so a file is sorted when each of its segments is and they chain.
+    std::vector<bool> sorted(files.size(), true), clean(files.size(), true);
+    std::vector<int64_t> lastKey(files.size(), 0);
+    std::vector<bool> seen(files.size(), false);
+    std::map<int32_t, DailyTotals> days;
+    for (const Segment& segment : segments) {
+        aggregate.rows += segment.rows;
+        aggregate.malformedRows += segment.malformedRows;
+        if (segment.malformedRows > 0) clean[segment.file] = false;
+        if (segment.rows > 0) {
+            if (!segment.sorted || (seen[segment.file] && segment.firstKey < lastKey[segment.file])) sorted[segment.file] = false;
+            seen[segment.file] = true;
+            lastKey[segment.file] = segment.lastKey;
+        }
+        for (const auto& entry : segment.days) {
+            DailyTotals& total = days[entry.first];
+            total.day = entry.first;
+            total.rows += entry.second.rows;
+            for (size_t t = 0; t < CALCULATION_TYPE_COUNT; ++t) total.typeCounts[t] += entry.second.typeCounts[t];
+            total.assayedPureGoldGrams += entry.second.assayedPureGoldGrams;
+            total.assayedValue += entry.second.assayedValue;
+        }
+    }
+    aggregate.days.reserve(days.size());
+    for (const auto& entry : days) aggregate.days.push_back(entry.second);
+
+    if (merged != nullptr) aggregate.mergedRows = mergeLogs(files, sorted, clean, *merged);
+    return aggregate;
+}
+
+void writeDailyTotals(std::ostream& out, const LogAggregate& aggregate) {
+    out << "Date,Rows,AssayedPureGold(g),AssayedValue";
+    for (size_t t = 1; t < CALCULATION_TYPE_COUNT; ++t) out << ',' << calculationTypeName(static_cast<CalculationType>(t));
+    out << ',' << calculationTypeName(CalculationType::Unknown) << "\n";
+    char line[256];
+    for (const DailyTotals& day : aggregate.days) {
+        int length = std::snprintf(line, sizeof(line), "%04d-%02d-%02d,%llu,%.4f,", day.day / 10000, day.day / 100 % 100, day.day % 100,
+            static_cast<unsigned long long>(day.rows), day.assayedPureGoldGrams);
+        out.write(line, length);
+        out.write(line, static_cast<std::streamsize>(day.assayedValue.format(line)));
+        for (size_t t = 1; t < CALCULATION_TYPE_COUNT; ++t) out << ',' << day.typeCounts[t];
+        out << ',' << day.typeCounts[0] << "\n";
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "calculation_log.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// --- Log Aggregation ---
+// Consolidates the calculation_log.csv files of several stores. Every input is memory-mapped and
+// cut into newline-aligned segments that are parsed in parallel into per-day partial totals. The
+// optional merged log is a streaming k-way heap merge by timestamp over the mapped files, so
+// memory stays flat however many rows there are. A file whose rows are not in time order (the
+// clock was set back) is merged through a sorted row index instead.
+
+const size_t CALCULATION_TYPE_COUNT = static_cast<size_t>(CalculationType::Investment) + 1;
+const size_t LOG_AGGREGATE_SEGMENT_BYTES = 16 * 1024 * 1024;
+
+struct DailyTotals {
+    int32_t day = 0;                                 // YYYYMMDD, local time as logged
+    uint64_t rows = 0;
+    uint64_t typeCounts[CALCULATION_TYPE_COUNT] = {}; // indexed by CalculationType
+    double assayedPureGoldGrams = 0.0;               // PurityFromWeight and PurityFromDensity rows
+    Money assayedValue;                              // their MarketValue at the price logged
+};
+
+struct LogAggregate {
+    std::vector<DailyTotals> days; // ascending
+    std::vector<std::string> unreadableFiles;
+    size_t files = 0;
+    uint64_t bytes = 0;
+    uint64_t rows = 0;
+    uint64_t malformedRows = 0;
+    uint64_t mergedRows = 0;
+};
+
+// Aggregates every path; when merged is given, also writes all rows of all files to it in time
+// order (ties keep the order of paths) under a single header.
+LogAggregate aggregateLogs(const std::vector<std::string>& paths, std::ostream* merged);
+
+void writeDailyTotals(std::ostream& out, const LogAggregate& aggregate);
@@ -0,0 +1,79 @@
+#include "metals.h"
+
+#include "durable_file.h"
+#include "instrumentation.h"
+#include "parsing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+MetalRegistry& metalRegistry() {
+    static MetalRegistry registry;
+    return registry;
+}
+
+namespace {
+
+// Calls onPart for each part of a blend spec, in place; false if any component is malformed,
+// unknown or a blend. A share is parsed where it lies, followed by '+' rather than '\0': strtod
+// cannot carry a number on past a '+' unless it already ended in an exponent mark, which fails anyway.
+template <typename PartFn>
+bool forEachBlendPart(const MetalRegistry& registry, const char* spec, size_t length, PartFn onPart) {
+    const char* last = spec + length;
+    for (const char* start = spec; start <= last;) {
+        const char* end = std::find(start, last, '+');
+        const char* colon = std::find(start, end, ':');
+
+        BlendPart part = { registry.find(start, static_cast<size_t>(colon - start)), 1.0 };
+        if (part.metal == INVALID_METAL_ID || registry.isBlend(part.metal)) return false;
+        if (colon != end && (!parseDouble(colon + 1, static_cast<size_t>(end - colon - 1), part.massShare) || !std::isfinite(part.massShare) || part.massShare <= 0)) {
+            return false;
+        }
+        onPart(part);
+        start = end + 1;
+    }
+    return true;
+}
+
+} // namespace
+
+MetalId resolveImpurity(MetalRegistry& registry, const std::string& spec) {
+    MetalId id = registry.find(spec);
+    if (id != INVALID_METAL_ID || spec.find('+') == std::string::npos) return id;
+
+    std::vector<BlendPart> parts;
+    if (!forEachBlendPart(registry, spec.c_str(), spec.size(), [&parts](const BlendPart& part) { parts.push_back(part); })) return INVALID_METAL_ID;
+    return registry.addBlend(spec, parts);
+}
+
+bool lookupImpurityDensity(const MetalRegistry& registry, const char* spec, size_t length, MetalId& id, double& density) {
+    id = registry.find(spec, length);
+    if (id != INVALID_METAL_ID) {
+        density = registry.get(id).density;
+        return true;
+    }
+    if (std::find(spec, spec + length, '+') == spec + length) return false;
+    double totalShare = 0.0, volume = 0.0; // summed in the same order as MetalRegistry::mixtureDensity
+    bool parsed = forEachBlendPart(registry, spec, length, [&](const BlendPart& part) {
+        totalShare += part.massShare;
+        volume += part.massShare / registry.get(part.metal).density;
+    });
+    if (!parsed) return false;
+    density = totalShare / volume;
+    return true;
+}
+
+void loadMetalsFile(const std::string& path, MetalRegistry& registry) {
+    GOLDASH_TIMED_SCOPE(TimedOperation::LoadMetals);
+    std::ifstream metalsFile(path);
+    Metal metal;
+    while (metalsFile >> metal.name >> metal.density) registry.add(metal);
+}
+
+bool saveMetalsFile(const std::string& path, const std::vector<Metal>& metals) {
+    std::ostringstream metalsFile;
+    for (const Metal& metal : metals) metalsFile << metal.name << " " << metal.density << "\n";
+    return writeFileAtomically(path, metalsFile.str());
+}
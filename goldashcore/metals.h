@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// --- Metals ---
+
+class Metal {
+public:
+    std::string name;
+    double density; // g/cm^3
+    Metal(std::string n = "", double d = 0.0) : name(n), density(d) {}
+};
+
+// --- Metal Registry ---
+// Maps metal names to dense integer handles. The built-in metals resolve through a compile-time
+// perfect hash; user-added metals go in an open-addressing table. Handles index straight into
+// the metal list, so a GoldItem only needs to carry a 4-byte MetalId.
+
+typedef uint32_t MetalId;
+const MetalId INVALID_METAL_ID = 0xFFFFFFFFu;
+
+// One component of an impurity blend; shares are mass ratios on any scale.
+struct BlendPart {
+    MetalId metal;
+    double massShare;
+};
+
+constexpr uint32_t fnv1a(const char* text, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) hash = (hash ^ static_cast<uint8_t>(text[i])) * 16777619u;
+    return hash;
+}
+
+constexpr size_t constexprLength(const char* text) { return *text ? 1 + constexprLength(text + 1) : 0; }
+
+struct BuiltinMetal {
+    const char* name;
+    double density;
+};
+
+constexpr BuiltinMetal BUILTIN_METALS[] = {
+    { "Copper", 8.96 }, { "Silver", 10.49 }, { "Platinum", 21.45 }, { "Palladium", 12.02 }
+};
+constexpr size_t BUILTIN_METAL_COUNT = sizeof(BUILTIN_METALS) / sizeof(BUILTIN_METALS[0]);
+constexpr uint32_t BUILTIN_HASH_MASK = 15;
+
+constexpr uint32_t builtinSlot(size_t index) {
+    return fnv1a(BUILTIN_METALS[index].name, constexprLength(BUILTIN_METALS[index].name)) & BUILTIN_HASH_MASK;
+}
+
+constexpr bool builtinSlotsAreUnique() {
+    for (size_t i = 0; i < BUILTIN_METAL_COUNT; ++i) {
+        for (size_t j = i + 1; j < BUILTIN_METAL_COUNT; ++j) {
+            if (builtinSlot(i) == builtinSlot(j)) return false;
+        }
+    }
+    return true;
+}
+static_assert(builtinSlotsAreUnique(), "built-in metal names collide; change BUILTIN_HASH_MASK");
+
+// Slot -> index into BUILTIN_METALS + 1 (0 = empty), generated at compile time.
+struct BuiltinHashTable {
+    uint8_t entries[BUILTIN_HASH_MASK + 1];
+    constexpr BuiltinHashTable() : entries() {
+        for (size_t i = 0; i < BUILTIN_METAL_COUNT; ++i) entries[builtinSlot(i)] = static_cast<uint8_t>(i + 1);
+    }
+};
+constexpr BuiltinHashTable BUILTIN_HASH_TABLE;
+
+class MetalRegistry {
+public:
+    MetalRegistry() {
+        for (MetalId& id : builtinIds) id = INVALID_METAL_ID;
+        userSlots.assign(16, INVALID_METAL_ID);
+    }
+
+    MetalId find(const std::string& name) const { return find(name.data(), name.size()); }
+
+    // Same for name[0, length), so a caller can look up part of a longer string without copying it.
+    MetalId find(const char* name, size_t length) const {
+        uint32_t hash = fnv1a(name, length);
+        uint8_t builtin = BUILTIN_HASH_TABLE.entries[hash & BUILTIN_HASH_MASK];
+        if (builtin != 0) {
+            const char* builtinName = BUILTIN_METALS[builtin - 1].name;
+            if (std::strlen(builtinName) == length && std::memcmp(builtinName, name, length) == 0) return builtinIds[builtin - 1];
+        }
+
+        size_t mask = userSlots.size() - 1;
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+            MetalId id = userSlots[slot];
+            if (id == INVALID_METAL_ID) return INVALID_METAL_ID;
+            if (metals[id].name.compare(0, std::string::npos, name, length) == 0) return id;
+        }
+    }
+
+    // Registers a metal, or updates the density of an existing one with the same name.
+    MetalId add(const Metal& metal) {
+        MetalId existing = find(metal.name);
+        if (existing != INVALID_METAL_ID) {
+            setDensity(existing, metal.density);
+            return existing;
+        }
+        MetalId id = static_cast<MetalId>(metals.size());
+        metals.push_back(metal);
+        blendParts.emplace_back();
+
+        uint32_t hash = fnv1a(metal.name.data(), metal.name.size());
+        uint8_t builtin = BUILTIN_HASH_TABLE.entries[hash & BUILTIN_HASH_MASK];
+        if (builtin != 0 && metal.name == BUILTIN_METALS[builtin - 1].name) {
+            builtinIds[builtin - 1] = id;
+        }
+        else {
+            if ((userCount + 1) * 10 > userSlots.size() * 7) rehash(userSlots.size() * 2);
+            insertUser(id, hash);
+            ++userCount;
+        }
+        return id;
+    }
+
+    // Registers a mix of other metals under the given name. Assuming the metals mix without
+    // changing volume, the blend behaves exactly like one metal of density
+    // sum(w) / sum(w_i / rho_i), so the single-impurity purity formula stays exact and closed-form.
+    // The blend density follows later changes to its components.
+    MetalId addBlend(const std::string& name, const std::vector<BlendPart>& parts) {
+        MetalId id = add(Metal(name, mixtureDensity(parts)));
+        blendParts[id] = parts;
+        return id;
+    }
+
+    bool isBlend(MetalId id) const { return !blendParts[id].empty(); }
+
+    void setDensity(MetalId id, double density) {
+        metals[id].density = density;
+        for (MetalId blend = 0; blend < metals.size(); ++blend) {
+            for (const BlendPart& part : blendParts[blend]) {
+                if (part.metal == id) {
+                    metals[blend].density = mixtureDensity(blendParts[blend]);
+                    break;
+                }
+            }
+        }
+    }
+
+    // The metals worth persisting; blends are rebuilt from their names when next used.
+    std::vector<Metal> savedMetals() const {
+        std::vector<Metal> saved;
+        for (MetalId id = 0; id < metals.size(); ++id) {
+            if (!isBlend(id)) saved.push_back(metals[id]);
+        }
+        return saved;
+    }
+
+    void clear() {
+        metals.clear();
+        blendParts.clear();
+        for (MetalId& id : builtinIds) id = INVALID_METAL_ID;
+        userSlots.assign(16, INVALID_METAL_ID);
+        userCount = 0;
+    }
+
+    bool contains(MetalId id) const { return id < metals.size(); }
+    const Metal& get(MetalId id) const { return metals[id]; }
+    const std::vector<Metal>& all() const { return metals; }
+    size_t size() const { return metals.size(); }
+    bool empty() const { return metals.empty(); }
+
+private:
+    std::vector<Metal> metals;
+    std::vector<std::vector<BlendPart>> blendParts; // parallel to metals, empty for plain metals
+    MetalId builtinIds[BUILTIN_METAL_COUNT];
+    std::vector<MetalId> userSlots; // power-of-two open-addressing table, linear probing
+    size_t userCount = 0;
+
+    double mixtureDensity(const std::vector<BlendPart>& parts) const {
+        double totalShare = 0.0, volume = 0.0;
+        for (const BlendPart& part : parts) {
+            totalShare += part.massShare;
+            volume += part.massShare / metals[part.metal].density;
+        }
+        return totalShare / volume;
+    }
+
+    void insertUser(MetalId id, uint32_t hash) {
+        size_t mask = userSlots.size() - 1;
+        size_t slot = hash & mask;
+        while (userSlots[slot] != INVALID_METAL_ID) slot = (slot + 1) & mask;
+        userSlots[slot] = id;
+    }
+
+    void rehash(size_t slotCount) {
+        std::vector<MetalId> old;
+        old.swap(userSlots);
+        userSlots.assign(slotCount, INVALID_METAL_ID);
+        for (MetalId id : old) {
+            if (id != INVALID_METAL_ID) insertUser(id, fnv1a(metals[id].name.data(), metals[id].name.size()));
+        }
+    }
+};
+
+// The registry shared by the calculators and GoldItem.
+MetalRegistry& metalRegistry();
+
+// Resolves a metal name, or a blend by mass ratio such as "Silver:3+Copper:1" (a component
+// without ":share" counts as one part), registering the blend on first use. Returns
+// INVALID_METAL_ID if the spec is malformed or names an unknown metal.
+MetalId resolveImpurity(MetalRegistry& registry, const std::string& spec);
+
+// The density of an impurity spec resolveImpurity would accept, without registering anything or
+// allocating: for callers that only hold the registry for reading, such as service workers. id is
+// the registered metal or blend, or INVALID_METAL_ID for a blend the registry does not know.
+// Returns false if the spec is malformed or names an unknown metal. spec[length] must be '\0'.
+bool lookupImpurityDensity(const MetalRegistry& registry, const char* spec, size_t length, MetalId& id, double& density);
+
+// metals.dat holds one "name density" line per metal. Blends are not saved.
+void loadMetalsFile(const std::string& path, MetalRegistry& registry);
+bool saveMetalsFile(const std::string& path, const std::vector<Metal>& metals); // replaces the file atomically; pass savedMetals()
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+// --- Money ---
+// A currency amount as a whole number of cents (paisa), so totals are plain integer adds and come
+// out the same however many rows go into them and in whatever order. Prices and masses stay double;
+// an amount becomes Money once, rounded half away from zero, when a price is applied. 64 bits hold
+// amounts up to about 9.2e16 currency units.
+
+class Money {
+public:
+    constexpr Money() : amount(0) {}
+
+    static constexpr Money fromCents(int64_t cents) { return Money(cents); }
+    static Money fromDouble(double value) { return Money(static_cast<int64_t>(std::llround(value * 100.0))); }
+
+    constexpr int64_t cents() const { return amount; }
+    constexpr double toDouble() const { return static_cast<double>(amount) / 100.0; }
+
+    constexpr Money operator+(Money other) const { return Money(amount + other.amount); }
+    constexpr Money operator-(Money other) const { return Money(amount - other.amount); }
+    constexpr Money operator-() const { return Money(-amount); }
+    Money& operator+=(Money other) { amount += other.amount; return *this; }
+    Money& operator-=(Money other) { amount -= other.amount; return *this; }
+
+    constexpr bool operator==(Money other) const { return amount == other.amount; }
+    constexpr bool operator!=(Money other) const { return amount != other.amount; }
+    constexpr bool operator<(Money other) const { return amount < other.amount; }
+    constexpr bool operator>(Money other) const { return amount > other.amount; }
+    constexpr bool operator<=(Money other) const { return amount <= other.amount; }
+    constexpr bool operator>=(Money other) const { return amount >= other.amount; }
+
+    // Writes "-1234.05" (always two decimals, no grouping) to out and returns its length; out
+    // needs MAX_TEXT_LENGTH chars.
+    static const size_t MAX_TEXT_LENGTH = 24;
+    size_t format(char* out) const {
+        char* cursor = out;
+        uint64_t magnitude = amount < 0 ? 0 - static_cast<uint64_t>(amount) : static_cast<uint64_t>(amount);
+        if (amount < 0) *cursor++ = '-';
+        cursor = std::to_chars(cursor, out + MAX_TEXT_LENGTH, magnitude / 100).ptr;
+        *cursor++ = '.';
+        *cursor++ = static_cast<char>('0' + magnitude / 10 % 10);
+        *cursor++ = static_cast<char>('0' + magnitude % 10);
+        return static_cast<size_t>(cursor - out);
+    }
+
+    std::string toString() const {
+        char text[MAX_TEXT_LENGTH];
+        return std::string(text, format(text));
+    }
+
+private:
+    int64_t amount; // cents
+
+    constexpr explicit Money(int64_t cents) : amount(cents) {}
+};
+
+static_assert(std::is_trivially_copyable<Money>::value && sizeof(Money) == 8, "Money is stored in binary files as int64 cents");
+
+// Honours the stream's width, so Money lines up in setw columns like a number does.
+inline std::ostream& operator<<(std::ostream& out, Money money) { return out << money.toString(); }
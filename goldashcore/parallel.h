@@ -0,0 +1,36 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// --- Parallel Helpers ---
+
+inline size_t workerThreadCount() {
+    unsigned hardware = std::thread::hardware_concurrency();
+    return hardware == 0 ? 1 : hardware;
+}
+
+// Calls body(chunkIndex, begin, end) for every chunkSize-sized slice of [0, count). Threads claim
+// chunks from a shared counter, so uneven chunks balance themselves. Chunk boundaries depend only
+// on count and chunkSize, so per-chunk partial results reduce to the same answer on any machine.
+template <typename Body>
+void parallelForChunks(size_t count, size_t chunkSize, Body body) {
+    if (count == 0) return;
+    size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+    std::atomic<size_t> nextChunk{ 0 };
+    auto work = [&]() {
+        for (size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+            size_t begin = chunk * chunkSize;
+            body(chunk, begin, std::min(count, begin + chunkSize));
+        }
+    };
+    size_t threadCount = std::min(workerThreadCount(), chunkCount);
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for (size_t i = 1; i < threadCount; ++i) threads.emplace_back(work);
+    work();
+    for (std::thread& thread : threads) thread.join();
+}
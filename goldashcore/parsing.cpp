@@ -0,0 +1,26 @@
+#include "parsing.h"
+
+#include <cstdlib>
+
+size_t splitCsvLine(const std::string& line, std::string* fields, size_t maxFields) {
+    size_t count = 0, start = 0;
+    while (count < maxFields && start <= line.size()) {
+        size_t end = line.find(',', start);
+        if (end == std::string::npos) end = line.size();
+        size_t first = start, last = end;
+        while (first < last && (line[first] == ' ' || line[first] == '\t')) ++first;
+        while (last > first && (line[last - 1] == ' ' || line[last - 1] == '\t' || line[last - 1] == '\r')) --last;
+        fields[count++].assign(line, first, last - first);
+        start = end + 1;
+    }
+    return count;
+}
+
+bool parseDouble(const std::string& text, double& value) { return parseDouble(text.c_str(), text.size(), value); }
+
+bool parseDouble(const char* text, size_t length, double& value) {
+    if (length == 0) return false;
+    char* end = nullptr;
+    value = std::strtod(text, &end);
+    return end == text + length;
+}
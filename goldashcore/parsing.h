@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// --- Parsing Helpers ---
+
+// Splits one CSV line into at most maxFields fields (no quoting support) and trims spaces.
+size_t splitCsvLine(const std::string& line, std::string* fields, size_t maxFields);
+
+// Parses the whole of text as a number.
+bool parseDouble(const std::string& text, double& value);
+
+// Same for text[0, length), which must be followed by a '\0' (as in any std::basic_string).
+bool parseDouble(const char* text, size_t length, double& value);
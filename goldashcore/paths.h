@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+// --- File Paths ---
+const std::string PRICE_FILENAME = "gold_price.dat";
+const std::string LOG_FILENAME = "calculation_log.csv";
+const std::string METALS_FILENAME = "metals.dat";
+const std::string CONFIG_FILENAME = "toolkit_config.dat";
+const std::string BINARY_LOG_FILENAME = "calculation_log.bin";
+const std::string PORTFOLIO_FILENAME = "portfolio.dat";
+const std::string REVALUATION_REPORT_FILENAME = "portfolio_revaluation.csv";
+const std::string SWEEP_REPORT_FILENAME = "portfolio_sweep.csv";
+const std::string STATE_FILENAME = "toolkit_state.bin";
+const std::string STATE_JOURNAL_FILENAME = "toolkit_state.journal";
+const std::string METRICS_FILENAME = "goldash_metrics.prom";
+const std::string LOG_SUMMARY_FILENAME = "calculation_log.summary";
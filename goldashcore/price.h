@@ -0,0 +1,335 @@
+#pragma once
+
+#include "durable_file.h"
+#include "instrumentation.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// --- Price History ---
+// gold_price.dat is an append-only time series of (timestamp, price, currency). After a 16-byte
+// header each entry is a zigzag varint of the timestamp delta (low bit set when a currency string
+// follows), the currency as a length-prefixed string if it changed, and a zigzag varint of the
+// price delta in 1/10000 currency units. A typical entry is 3-5 bytes. The file is decoded once
+// into sorted columns: the latest price is O(1) and an as-of-time lookup is a binary search.
+
+const char PRICE_HISTORY_MAGIC[8] = { 'G', 'D', 'A', 'S', 'H', 'P', 'R', 'C' };
+const uint32_t PRICE_HISTORY_VERSION = 1;
+const double PRICE_TICKS_PER_UNIT = 10000.0;
+
+void writeVarint(std::string& out, uint64_t value);
+bool readVarint(const std::string& in, size_t& pos, uint64_t& value);
+uint64_t zigzagEncode(int64_t value);
+int64_t zigzagDecode(uint64_t value);
+
+class PriceHistory {
+public:
+    // Decodes path. A legacy text file (one or more plain prices) is converted in place, and a torn
+    // trailing entry is dropped. Returns false if the file exists but cannot be read or is neither
+    // a price history nor a legacy price list; such a file is left untouched and append() refuses
+    // to write to it.
+    bool load(const std::string& filePath) {
+        GOLDASH_TIMED_SCOPE(TimedOperation::LoadPriceHistory);
+        path = filePath;
+        timestamps.clear();
+        prices.clear();
+        currencyIndex.clear();
+        currencies.clear();
+        internCurrency(""); // entries before the first currency record have no symbol
+        lastTicks = 0;
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) return true;
+        std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        file.close();
+        if (bytes.empty()) return true;
+        if (bytes.size() < 16 || std::memcmp(bytes.data(), PRICE_HISTORY_MAGIC, sizeof(PRICE_HISTORY_MAGIC)) != 0) {
+            std::vector<double> legacy;
+            if (!parseLegacy(bytes, legacy) || !migrateLegacy(legacy)) return refuseWrites();
+            return true;
+        }
+        uint32_t version;
+        std::memcpy(&version, bytes.data() + 8, sizeof(version));
+        if (version != PRICE_HISTORY_VERSION) return refuseWrites();
+
+        size_t pos = 16, validEnd = 16;
+        int64_t timestamp = 0, ticks = 0;
+        uint16_t currency = 0;
+        for (;;) {
+            uint64_t header, priceDelta;
+            if (!readVarint(bytes, pos, header)) break;
+            if (header & 1) {
+                if (pos >= bytes.size()) break;
+                size_t length = static_cast<uint8_t>(bytes[pos++]);
+                if (pos + length > bytes.size()) break;
+                currency = internCurrency(bytes.substr(pos, length));
+                pos += length;
+            }
+            if (!readVarint(bytes, pos, priceDelta)) break;
+            timestamp += zigzagDecode(header >> 1);
+            ticks += zigzagDecode(priceDelta);
+            timestamps.push_back(timestamp);
+            prices.push_back(static_cast<double>(ticks) / PRICE_TICKS_PER_UNIT);
+            currencyIndex.push_back(currency);
+            validEnd = pos;
+        }
+        lastTicks = ticks;
+        if (validEnd != bytes.size()) {
+            std::error_code error;
+            std::filesystem::resize_file(path, validEnd, error);
+        }
+        return true;
+    }
+
+    // Appends one entry, flushed, to disk and then to memory, so a failed write leaves both as they
+    // were and the next entry is still encoded against the file's real tail. Timestamps never go
+    // backwards.
+    bool append(int64_t timestamp, double price, const std::string& currency) {
+        if (path.empty()) return false;
+        if (!timestamps.empty()) timestamp = std::max(timestamp, timestamps.back());
+        std::string symbol = currency.substr(0, 255);
+        int64_t ticks = std::llround(price * PRICE_TICKS_PER_UNIT);
+        std::string entry;
+        encodeEntry(entry, timestamp, ticks, symbol);
+        std::error_code error;
+        bool newFile = !std::filesystem::exists(path, error) || std::filesystem::file_size(path, error) == 0;
+        if (!appendDurably(path, newFile ? headerBytes() + entry : entry)) return false;
+        recordEntry(timestamp, ticks, symbol);
+        return true;
+    }
+
+    bool empty() const { return prices.empty(); }
+    size_t size() const { return prices.size(); }
+    double latestPrice() const { return prices.empty() ? 0.0 : prices.back(); }
+    int64_t latestTimestamp() const { return timestamps.empty() ? 0 : timestamps.back(); }
+    const std::string& latestCurrency() const { return currencyAt(prices.size() - 1); }
+    const std::string& currencyAt(size_t index) const {
+        static const std::string none;
+        return index < currencyIndex.size() ? currencies[currencyIndex[index]] : none;
+    }
+
+    // Price in effect at the given time: the last entry at or before it (0 if none).
+    double priceAt(int64_t timestamp) const {
+        auto found = std::upper_bound(timestamps.begin(), timestamps.end(), timestamp);
+        if (found == timestamps.begin()) return 0.0;
+        return prices[static_cast<size_t>(found - timestamps.begin()) - 1];
+    }
+
+    // Last price of each UTC day that has one, oldest first.
+    std::vector<double> dailyClosingPrices() const {
+        const int64_t SECONDS_PER_DAY = 24 * 60 * 60;
+        std::vector<double> closes;
+        for (size_t i = 0; i < prices.size(); ++i) {
+            bool lastOfDay = i + 1 == prices.size() || timestamps[i + 1] / SECONDS_PER_DAY != timestamps[i] / SECONDS_PER_DAY;
+            if (lastOfDay) closes.push_back(prices[i]);
+        }
+        return closes;
+    }
+
+private:
+    std::string path;
+    std::vector<int64_t> timestamps;
+    std::vector<double> prices;
+    std::vector<uint16_t> currencyIndex;
+    std::vector<std::string> currencies;
+    int64_t lastTicks = 0;
+
+    static std::string headerBytes() {
+        std::string header(PRICE_HISTORY_MAGIC, sizeof(PRICE_HISTORY_MAGIC));
+        uint32_t fields[2] = { PRICE_HISTORY_VERSION, 0 };
+        header.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+        return header;
+    }
+
+    // An entry appended to a file load() could not make sense of would be unreadable after it.
+    bool refuseWrites() {
+        path.clear();
+        return false;
+    }
+
+    uint16_t internCurrency(const std::string& currency) {
+        for (size_t i = 0; i < currencies.size(); ++i) {
+            if (currencies[i] == currency) return static_cast<uint16_t>(i);
+        }
+        currencies.push_back(currency);
+        return static_cast<uint16_t>(currencies.size() - 1);
+    }
+
+    // Encodes an entry relative to the current last entry in memory, without recording it.
+    void encodeEntry(std::string& out, int64_t timestamp, int64_t ticks, const std::string& symbol) const {
+        bool currencyChanged = prices.empty() ? !symbol.empty() : currencyAt(prices.size() - 1) != symbol;
+        int64_t timeDelta = timestamps.empty() ? timestamp : timestamp - timestamps.back();
+        writeVarint(out, (zigzagEncode(timeDelta) << 1) | (currencyChanged ? 1 : 0));
+        if (currencyChanged) {
+            out.push_back(static_cast<char>(symbol.size()));
+            out += symbol;
+        }
+        writeVarint(out, zigzagEncode(ticks - lastTicks));
+    }
+
+    void recordEntry(int64_t timestamp, int64_t ticks, const std::string& symbol) {
+        timestamps.push_back(timestamp);
+        prices.push_back(static_cast<double>(ticks) / PRICE_TICKS_PER_UNIT);
+        currencyIndex.push_back(internCurrency(symbol));
+        lastTicks = ticks;
+    }
+
+    // True if text is the old plain-text price file: one or more finite prices separated by
+    // whitespace and nothing else. A torn or corrupt binary history does not parse as one.
+    static bool parseLegacy(const std::string& text, std::vector<double>& legacy) {
+        std::istringstream stream(text);
+        for (double price; stream >> price;) {
+            if (!std::isfinite(price)) return false;
+            legacy.push_back(price);
+        }
+        return stream.eof() && !legacy.empty();
+    }
+
+    // Converts the old plain-text price file. Its values have no times of their own, so they are
+    // stamped one second apart, ending at the file's modification time.
+    bool migrateLegacy(const std::vector<double>& legacy) {
+        std::error_code error;
+        auto modified = std::filesystem::last_write_time(path, error);
+        int64_t endTime = std::time(nullptr);
+        if (!error) {
+            auto age = std::filesystem::file_time_type::clock::now() - modified;
+            endTime -= std::chrono::duration_cast<std::chrono::seconds>(age).count();
+        }
+
+        std::string bytes = headerBytes();
+        for (size_t i = 0; i < legacy.size(); ++i) {
+            int64_t timestamp = endTime - static_cast<int64_t>(legacy.size() - 1 - i);
+            int64_t ticks = std::llround(legacy[i] * PRICE_TICKS_PER_UNIT);
+            encodeEntry(bytes, timestamp, ticks, "");
+            recordEntry(timestamp, ticks, "");
+        }
+        return writeFileAtomically(path, bytes);
+    }
+};
+
+// --- Live Price ---
+// The current gold price lives in a seqlock so the feed thread can publish ticks while
+// calculators read a consistent (price, timestamp) pair without taking a lock.
+
+struct PriceSnapshot {
+    double pricePerGram;
+    int64_t timestamp;
+};
+
+class PriceCell {
+public:
+    void publish(double pricePerGram, int64_t timestamp) {
+        std::lock_guard<std::mutex> lock(writerMutex); // writers are rare: the feed and the price menu
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        price.store(pricePerGram, std::memory_order_relaxed);
+        time.store(timestamp, std::memory_order_relaxed);
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    PriceSnapshot read() const {
+        for (;;) {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            PriceSnapshot snapshot = { price.load(std::memory_order_relaxed), time.load(std::memory_order_relaxed) };
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if ((before & 1) == 0 && sequence.load(std::memory_order_relaxed) == before) return snapshot;
+        }
+    }
+
+private:
+    std::atomic<uint32_t> sequence{ 0 };
+    std::atomic<double> price{ 0.0 };
+    std::atomic<int64_t> time{ 0 };
+    std::mutex writerMutex;
+};
+
+// Watches a price file written by an external fetcher (for example a script polling a rates API).
+// The last non-empty line holds the current price per gram; each change is published to the cell
+// and handed to onTick, on the feed thread.
+class PriceFeed {
+public:
+    PriceFeed(const std::string& path, PriceCell& cell, std::function<void(double, int64_t)> onTick)
+        : path(path), cell(cell), onTick(onTick) {}
+
+    ~PriceFeed() { stop(); }
+
+    void start() {
+        if (running) return;
+        running = true;
+        worker = std::thread(&PriceFeed::watchLoop, this);
+    }
+
+    void stop() {
+        if (!running) return;
+        running = false;
+        worker.join();
+    }
+
+private:
+    static constexpr int POLL_INTERVAL_MS = 100;
+    static constexpr std::streamoff TAIL_BYTES = 256;
+
+    std::string path;
+    PriceCell& cell;
+    std::function<void(double, int64_t)> onTick;
+    std::atomic<bool> running{ false };
+    std::thread worker;
+
+    bool readLatestPrice(double& price) const {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) return false;
+        std::streamoff size = file.tellg();
+        std::streamoff start = std::max<std::streamoff>(0, size - TAIL_BYTES);
+        file.seekg(start);
+        std::string tail(static_cast<size_t>(size - start), '\0');
+        file.read(&tail[0], static_cast<std::streamsize>(tail.size()));
+
+        size_t end = tail.find_last_not_of(" \t\r\n");
+        if (end == std::string::npos) return false;
+        size_t begin = tail.find_last_of('\n', end);
+        begin = begin == std::string::npos ? 0 : begin + 1;
+        char* parsedEnd = nullptr;
+        std::string line = tail.substr(begin, end - begin + 1);
+        price = std::strtod(line.c_str(), &parsedEnd);
+        return parsedEnd != line.c_str() && price > 0;
+    }
+
+    void watchLoop() {
+        std::filesystem::file_time_type lastWrite{};
+        uintmax_t lastSize = 0;
+        double lastPrice = 0.0;
+        while (running) {
+            std::error_code error;
+            auto write = std::filesystem::last_write_time(path, error);
+            uintmax_t size = error ? 0 : std::filesystem::file_size(path, error);
+            double price;
+            if (!error && (write != lastWrite || size != lastSize) && readLatestPrice(price)) {
+                lastWrite = write;
+                lastSize = size;
+                if (price != lastPrice) {
+                    lastPrice = price;
+                    int64_t now = static_cast<int64_t>(std::time(nullptr));
+                    cell.publish(price, now);
+                    if (onTick) onTick(price, now);
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+        }
+    }
+};
@@ -0,0 +1,390 @@
+#include "purity.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define GOLDASH_HAS_AVX2_KERNEL 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define GOLDASH_HAS_NEON_KERNEL 1
+#include <arm_neon.h>
+#endif
+
+#if GOLDASH_HAS_AVX2_KERNEL
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("avx2")))
+#endif
+inline size_t computePurityAvx2(size_t count, const double* massGrams, const double* density,
+    const double* impurityDensity, double* purityPercent, double* karats, double* pureGoldGrams) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d gold = _mm256_set1_pd(PURE_GOLD_DENSITY);
+    const __m256d tolerance = _mm256_set1_pd(DENSITY_TOLERANCE);
+    const __m256d hundred = _mm256_set1_pd(100.0);
+    const __m256d karatScale = _mm256_set1_pd(24.0 / 100.0);
+    const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d m = _mm256_loadu_pd(massGrams + i);
+        __m256d d = _mm256_loadu_pd(density + i);
+        __m256d imp = _mm256_loadu_pd(impurityDensity + i);
+
+        // _mm256_min_pd(imp, gold) matches std::min(gold, imp) (and max likewise), NaN lanes included.
+        __m256d lowerBound = _mm256_sub_pd(_mm256_min_pd(imp, gold), tolerance);
+        __m256d upperBound = _mm256_add_pd(_mm256_max_pd(imp, gold), tolerance);
+        __m256d valid = _mm256_and_pd(_mm256_cmp_pd(d, zero, _CMP_GT_OQ), _mm256_cmp_pd(imp, zero, _CMP_GT_OQ));
+        valid = _mm256_and_pd(valid, _mm256_cmp_pd(d, lowerBound, _CMP_GE_OQ));
+        valid = _mm256_and_pd(valid, _mm256_cmp_pd(d, upperBound, _CMP_LE_OQ));
+        valid = _mm256_and_pd(valid, _mm256_cmp_pd(m, zero, _CMP_GT_OQ));
+
+        __m256d fraction = _mm256_div_pd(_mm256_sub_pd(d, imp), _mm256_sub_pd(gold, imp));
+        __m256d pure = _mm256_mul_pd(_mm256_mul_pd(fraction, _mm256_div_pd(m, d)), gold);
+        __m256d nearPure = _mm256_cmp_pd(_mm256_and_pd(_mm256_sub_pd(d, gold), absMask), tolerance, _CMP_LT_OQ);
+        pure = _mm256_blendv_pd(pure, m, nearPure);
+        pure = _mm256_blendv_pd(zero, pure, valid);
+
+        __m256d noPurity = _mm256_or_pd(_mm256_cmp_pd(m, zero, _CMP_LE_OQ), _mm256_cmp_pd(pure, zero, _CMP_LE_OQ));
+        __m256d purity = _mm256_blendv_pd(_mm256_mul_pd(_mm256_div_pd(pure, m), hundred), zero, noPurity);
+
+        _mm256_storeu_pd(pureGoldGrams + i, pure);
+        _mm256_storeu_pd(purityPercent + i, purity);
+        _mm256_storeu_pd(karats + i, _mm256_mul_pd(purity, karatScale));
+    }
+    _mm256_zeroupper();
+    return i;
+}
+
+inline bool cpuSupportsAvx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5));
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+#if GOLDASH_HAS_NEON_KERNEL
+inline size_t computePurityNeon(size_t count, const double* massGrams, const double* density,
+    const double* impurityDensity, double* purityPercent, double* karats, double* pureGoldGrams) {
+    const float64x2_t zero = vdupq_n_f64(0.0);
+    const float64x2_t gold = vdupq_n_f64(PURE_GOLD_DENSITY);
+    const float64x2_t tolerance = vdupq_n_f64(DENSITY_TOLERANCE);
+    const float64x2_t hundred = vdupq_n_f64(100.0);
+    const float64x2_t karatScale = vdupq_n_f64(24.0 / 100.0);
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        float64x2_t m = vld1q_f64(massGrams + i);
+        float64x2_t d = vld1q_f64(density + i);
+        float64x2_t imp = vld1q_f64(impurityDensity + i);
+
+        // Explicit compare/select keeps std::min/std::max semantics (vminq_f64 propagates NaN).
+        float64x2_t lowerBound = vsubq_f64(vbslq_f64(vcltq_f64(imp, gold), imp, gold), tolerance);
+        float64x2_t upperBound = vaddq_f64(vbslq_f64(vcltq_f64(gold, imp), imp, gold), tolerance);
+        uint64x2_t valid = vandq_u64(vcgtq_f64(d, zero), vcgtq_f64(imp, zero));
+        valid = vandq_u64(valid, vcgeq_f64(d, lowerBound));
+        valid = vandq_u64(valid, vcleq_f64(d, upperBound));
+        valid = vandq_u64(valid, vcgtq_f64(m, zero));
+
+        float64x2_t fraction = vdivq_f64(vsubq_f64(d, imp), vsubq_f64(gold, imp));
+        float64x2_t pure = vmulq_f64(vmulq_f64(fraction, vdivq_f64(m, d)), gold);
+        pure = vbslq_f64(vcltq_f64(vabsq_f64(vsubq_f64(d, gold)), tolerance), m, pure);
+        pure = vbslq_f64(valid, pure, zero);
+
+        uint64x2_t noPurity = vorrq_u64(vcleq_f64(m, zero), vcleq_f64(pure, zero));
+        float64x2_t purity = vbslq_f64(noPurity, zero, vmulq_f64(vdivq_f64(pure, m), hundred));
+
+        vst1q_f64(pureGoldGrams + i, pure);
+        vst1q_f64(purityPercent + i, purity);
+        vst1q_f64(karats + i, vmulq_f64(purity, karatScale));
+    }
+    return i;
+}
+#endif
+
+void computePurityBulk(size_t count, const double* massGrams, const double* density, const double* impurityDensity,
+    double* purityPercent, double* karats, double* pureGoldGrams) {
+    size_t done = 0;
+#if GOLDASH_HAS_AVX2_KERNEL
+    static const bool hasAvx2 = cpuSupportsAvx2();
+    if (hasAvx2) done = computePurityAvx2(count, massGrams, density, impurityDensity, purityPercent, karats, pureGoldGrams);
+#elif GOLDASH_HAS_NEON_KERNEL
+    done = computePurityNeon(count, massGrams, density, impurityDensity, purityPercent, karats, pureGoldGrams);
+#endif
+    computePurityScalar(done, count, massGrams, density, impurityDensity, purityPercent, karats, pureGoldGrams);
+}
+
+PurityResult assayFromDensity(double massGrams, double density, double impurityDensity) {
+    PurityResult result;
+    result.density = density;
+    computePurityScalar(0, 1, &massGrams, &density, &impurityDensity, &result.purityPercent, &result.karats, &result.pureGoldGrams);
+    return result;
+}
+
+PurityResult assayFromWeight(double weightInAirGrams, double weightInWaterGrams, double impurityDensity) {
+    double density = 0.0;
+    if (weightInAirGrams > weightInWaterGrams && weightInWaterGrams > 0) density = weightInAirGrams / (weightInAirGrams - weightInWaterGrams);
+    return assayFromDensity(weightInAirGrams, density, impurityDensity);
+}
+
+KaratDensityTable karatDensityTable(const Metal& impurity) {
+    for (size_t i = 0; i < BUILTIN_METAL_COUNT; ++i) {
+        if (impurity.density == BUILTIN_METALS[i].density && impurity.name == BUILTIN_METALS[i].name) return BUILTIN_KARAT_TABLES.tables[i];
+    }
+    return makeKaratDensityTable(impurity.density);
+}
+
+int nearestTableKarat(const KaratDensityTable& table, double density) {
+    const double* first = table.density;
+    const double* last = table.density + KARAT_TABLE_SIZE;
+    bool ascending = first[0] <= last[-1];
+    double lowest = ascending ? first[0] : last[-1];
+    double highest = ascending ? last[-1] : first[0];
+    if (!(density >= lowest - DENSITY_TOLERANCE && density <= highest + DENSITY_TOLERANCE)) return 0;
+
+    const double* found = ascending ? std::lower_bound(first, last, density)
+        : std::lower_bound(first, last, density, [](double entry, double value) { return entry > value; });
+    if (found == last) --found;
+    else if (found != first && std::abs(found[-1] - density) <= std::abs(*found - density)) --found;
+    return TABLE_MIN_KARAT + static_cast<int>(found - first);
+}
+
+// --- Assay Cache ---
+
+namespace {
+
+struct AssayCacheEntry {
+    double mass;
+    double density;
+    double impurityDensity;
+    double purityPercent;
+    double karats;
+    double pureGoldGrams;
+};
+
+// A set's tags fit in a few cache-resident bytes, so a probe reads one entry at most.
+struct AssayCacheSet {
+    uint32_t tags[ASSAY_CACHE_WAYS] = {}; // hash bits with the low bit set; 0 = empty way
+    uint8_t referenced = 0;               // CLOCK bit per way: set on a hit, cleared as the hand passes
+    uint8_t hand = 0;
+};
+
+// One thread's table. Only the owning thread writes; the generation and counters are atomics with
+// relaxed load + store so assayCacheStats() can read them concurrently, as with the latency
+// histograms. inUse is guarded by the registry mutex.
+struct ThreadAssayCache {
+    std::vector<AssayCacheSet> sets = std::vector<AssayCacheSet>(ASSAY_CACHE_SETS);
+    std::vector<AssayCacheEntry> slots = std::vector<AssayCacheEntry>(ASSAY_CACHE_SETS * ASSAY_CACHE_WAYS); // [set][way]
+    std::atomic<uint64_t> generation{ 0 };
+    std::atomic<uint64_t> hits{ 0 };
+    std::atomic<uint64_t> misses{ 0 };
+    std::atomic<uint64_t> evictions{ 0 };
+    std::atomic<uint64_t> entries{ 0 };
+    bool inUse = false;
+};
+
+std::atomic<uint64_t> assayCacheGeneration{ 0 };
+
+// Tables are never freed: a thread that exits hands its table (and its counts) to the next new
+// thread, so service workers that come and go do not leak or lose hit counts.
+struct AssayCacheRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadAssayCache>> caches;
+};
+
+AssayCacheRegistry& assayCacheRegistry() {
+    static AssayCacheRegistry registry;
+    return registry;
+}
+
+thread_local ThreadAssayCache* threadAssayCache = nullptr;
+
+struct ThreadAssayCacheRelease {
+    ~ThreadAssayCacheRelease() {
+        if (threadAssayCache == nullptr) return;
+        std::lock_guard<std::mutex> lock(assayCacheRegistry().mutex);
+        threadAssayCache->inUse = false;
+        threadAssayCache = nullptr;
+    }
+};
+
+ThreadAssayCache& claimThreadAssayCache() {
+    thread_local ThreadAssayCacheRelease release; // registers the release at thread exit
+    AssayCacheRegistry& registry = assayCacheRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const std::unique_ptr<ThreadAssayCache>& cache : registry.caches) {
+        if (!cache->inUse) {
+            cache->inUse = true;
+            return *(threadAssayCache = cache.get());
+        }
+    }
+    registry.caches.emplace_back(new ThreadAssayCache());
+    registry.caches.back()->inUse = true;
+    return *(threadAssayCache = registry.caches.back().get());
+}
+
+inline void increment(std::atomic<uint64_t>& counter, uint64_t amount = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// The calling thread's table, emptied first if invalidateAssayCaches() ran since it was last used.
+ThreadAssayCache& currentAssayCache() {
+    ThreadAssayCache& cache = threadAssayCache != nullptr ? *threadAssayCache : claimThreadAssayCache();
+    uint64_t generation = assayCacheGeneration.load(std::memory_order_acquire);
+    if (cache.generation.load(std::memory_order_relaxed) != generation) {
+        for (AssayCacheSet& set : cache.sets) set = AssayCacheSet();
+        cache.entries.store(0, std::memory_order_relaxed);
+        cache.generation.store(generation, std::memory_order_relaxed);
+    }
+    return cache;
+}
+
+struct AssayKey {
+    double mass;
+    double density;
+    double impurityDensity;
+};
+
+// NaN never equals itself, so non-finite inputs would only fill the table with dead entries.
+bool makeAssayKey(double massGrams, double density, double impurityDensity, AssayKey& key) {
+    if (!(std::isfinite(massGrams) && std::isfinite(density) && std::isfinite(impurityDensity))) return false;
+    key = { massGrams + 0.0, density + 0.0, impurityDensity + 0.0 }; // -0.0 becomes 0.0, so equal keys hash alike
+    return true;
+}
+
+inline uint64_t keyBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+uint64_t hashKey(const AssayKey& key) {
+    uint64_t hash = keyBits(key.mass) * 0x9E3779B97F4A7C15ull;
+    hash = (hash ^ (hash >> 29) ^ keyBits(key.density)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 32) ^ keyBits(key.impurityDensity)) * 0x94D049BB133111EBull;
+    return hash ^ (hash >> 31);
+}
+
+inline size_t setIndex(uint64_t hash) { return static_cast<size_t>(hash >> 40) & (ASSAY_CACHE_SETS - 1); }
+inline uint32_t tagOf(uint64_t hash) { return static_cast<uint32_t>(hash) | 1u; }
+
+bool findIn(ThreadAssayCache& cache, const AssayKey& key, PurityResult& result) {
+    uint64_t hash = hashKey(key);
+    size_t index = setIndex(hash);
+    AssayCacheSet& set = cache.sets[index];
+    uint32_t tag = tagOf(hash);
+    for (size_t way = 0; way < ASSAY_CACHE_WAYS; ++way) {
+        if (set.tags[way] != tag) continue;
+        const AssayCacheEntry& entry = cache.slots[index * ASSAY_CACHE_WAYS + way];
+        if (entry.mass == key.mass && entry.density == key.density && entry.impurityDensity == key.impurityDensity) {
+            set.referenced |= static_cast<uint8_t>(1u << way);
+            result = { entry.density, entry.purityPercent, entry.karats, entry.pureGoldGrams };
+            increment(cache.hits);
+            return true;
+        }
+    }
+    increment(cache.misses);
+    return false;
+}
+
+void storeIn(ThreadAssayCache& cache, const AssayKey& key, const PurityResult& result) {
+    uint64_t hash = hashKey(key);
+    size_t index = setIndex(hash);
+    AssayCacheSet& set = cache.sets[index];
+    size_t way = 0;
+    while (way < ASSAY_CACHE_WAYS && set.tags[way] != 0) ++way;
+    if (way < ASSAY_CACHE_WAYS) {
+        increment(cache.entries);
+    }
+    else {
+        while (set.referenced & (1u << set.hand)) {
+            set.referenced = static_cast<uint8_t>(set.referenced & ~(1u << set.hand));
+            set.hand = static_cast<uint8_t>((set.hand + 1) % ASSAY_CACHE_WAYS);
+        }
+        way = set.hand;
+        set.hand = static_cast<uint8_t>((set.hand + 1) % ASSAY_CACHE_WAYS);
+        increment(cache.evictions);
+    }
+    set.tags[way] = tagOf(hash);
+    set.referenced = static_cast<uint8_t>(set.referenced & ~(1u << way));
+    cache.slots[index * ASSAY_CACHE_WAYS + way] = { key.mass, key.density, key.impurityDensity, result.purityPercent, result.karats, result.pureGoldGrams };
+}
+
+} // namespace
+
+PurityResult cachedAssay(double massGrams, double density, double impurityDensity) {
+    AssayKey key;
+    if (!makeAssayKey(massGrams, density, impurityDensity, key)) return assayFromDensity(massGrams, density, impurityDensity);
+    ThreadAssayCache& cache = currentAssayCache();
+    PurityResult result;
+    if (findIn(cache, key, result)) {
+        result.density = density; // the key folds -0 into +0; hand back the caller's, as assayFromDensity would
+        return result;
+    }
+    result = assayFromDensity(massGrams, density, impurityDensity);
+    storeIn(cache, key, result);
+    return result;
+}
+
+bool findCachedAssay(double massGrams, double density, double impurityDensity, PurityResult& result) {
+    AssayKey key;
+    if (!makeAssayKey(massGrams, density, impurityDensity, key) || !findIn(currentAssayCache(), key, result)) return false;
+    result.density = density;
+    return true;
+}
+
+void storeCachedAssay(double massGrams, double density, double impurityDensity, const PurityResult& result) {
+    AssayKey key;
+    if (makeAssayKey(massGrams, density, impurityDensity, key)) storeIn(currentAssayCache(), key, result);
+}
+
+void invalidateAssayCaches() { assayCacheGeneration.fetch_add(1, std::memory_order_acq_rel); }
+
+void AssayCacheStats::subtract(const AssayCacheStats& earlier) {
+    hits -= std::min(hits, earlier.hits);
+    misses -= std::min(misses, earlier.misses);
+    evictions -= std::min(evictions, earlier.evictions);
+    invalidations -= std::min(invalidations, earlier.invalidations);
+}
+
+AssayCacheStats assayCacheStats() {
+    AssayCacheStats stats;
+    uint64_t generation = assayCacheGeneration.load(std::memory_order_acquire);
+    stats.invalidations = generation;
+    AssayCacheRegistry& registry = assayCacheRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const std::unique_ptr<ThreadAssayCache>& cache : registry.caches) {
+        stats.hits += cache->hits.load(std::memory_order_relaxed);
+        stats.misses += cache->misses.load(std::memory_order_relaxed);
+        stats.evictions += cache->evictions.load(std::memory_order_relaxed);
+        stats.capacity += ASSAY_CACHE_SETS * ASSAY_CACHE_WAYS;
+        if (cache->generation.load(std::memory_order_relaxed) == generation) stats.entries += cache->entries.load(std::memory_order_relaxed); // stale tables empty on next use
+    }
+    return stats;
+}
+
+void writeAssayCacheMetrics(std::ostream& out, const AssayCacheStats& stats) {
+    const struct { const char* name; const char* help; uint64_t value; } COUNTERS[] = {
+        { "goldash_assay_cache_hits_total", "Assays answered from the cache.", stats.hits },
+        { "goldash_assay_cache_misses_total", "Assays computed and added to the cache.", stats.misses },
+        { "goldash_assay_cache_evictions_total", "Cache entries replaced by the CLOCK hand.", stats.evictions },
+        { "goldash_assay_cache_invalidations_total", "Times every cache was emptied after a density change.", stats.invalidations },
+    };
+    for (const auto& counter : COUNTERS) {
+        out << "# HELP " << counter.name << " " << counter.help << "\n# TYPE " << counter.name << " counter\n" << counter.name << " " << counter.value << "\n";
+    }
+    out << "# HELP goldash_assay_cache_entries Results currently cached.\n# TYPE goldash_assay_cache_entries gauge\n"
+        << "goldash_assay_cache_entries " << stats.entries << "\n";
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include "instrumentation.h"
+#include "metals.h"
+#include "units.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// --- Physical Constants ---
+constexpr double PURE_GOLD_DENSITY = 19.32;  // g/cm^3
+constexpr double DENSITY_TOLERANCE = 0.05;   // g/cm^3, measurement slack around the valid range
+
+struct PurityResult {
+    double density;
+    double purityPercent;
+    double karats;
+    double pureGoldGrams;
+};
+
+// --- Assay Cache ---
+// The same (mass, density, impurity density) assays come up again and again: standard bars,
+// re-tests, a lot priced twice. Each thread keeps a CLOCK-evicted, set-associative table of
+// results keyed on those inputs. Keys are exact: the purity is sensitive enough to density that
+// rounding it even to 1e-6 g/cm^3 changes printed results, and repeats of a bar arrive as the same
+// typed or logged numbers anyway. invalidateAssayCaches() empties every thread's table; call it
+// when a metal density changes.
+
+const size_t ASSAY_CACHE_SETS = 1024; // per thread; a power of two
+const size_t ASSAY_CACHE_WAYS = 4;
+
+struct AssayCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t invalidations = 0; // invalidateAssayCaches() calls, since startup
+    uint64_t entries = 0;
+    uint64_t capacity = 0;
+
+    double hitRate() const { return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(hits + misses); }
+    void subtract(const AssayCacheStats& earlier); // counters only; entries and capacity are kept
+};
+
+// The assay of massGrams at density against impurityDensity, from the calling thread's cache or
+// computed and cached. Non-finite inputs bypass the cache.
+PurityResult cachedAssay(double massGrams, double density, double impurityDensity);
+
+// Split lookup and store for callers that compute misses in bulk (see runBatch).
+bool findCachedAssay(double massGrams, double density, double impurityDensity, PurityResult& result);
+void storeCachedAssay(double massGrams, double density, double impurityDensity, const PurityResult& result);
+
+void invalidateAssayCaches();
+
+// Sums every thread's counters. Safe to call while other threads assay.
+AssayCacheStats assayCacheStats();
+
+// Prometheus counters for the cache, in the same exposition format as writePrometheusMetrics.
+void writeAssayCacheMetrics(std::ostream& out, const AssayCacheStats& stats);
+
+// Whether a measured density lies between pure gold and the impurity, within DENSITY_TOLERANCE.
+inline bool isDensityInRange(double density, double impurityDensity) {
+    double lowerBound = std::min(PURE_GOLD_DENSITY, impurityDensity);
+    double upperBound = std::max(PURE_GOLD_DENSITY, impurityDensity);
+    return density > 0 && density >= lowerBound - DENSITY_TOLERANCE && density <= upperBound + DENSITY_TOLERANCE;
+}
+
+// --- Gold Items ---
+
+class GoldItem {
+private:
+    double totalMassGrams;
+    double density;
+    MetalId impurity;
+
+    double impurityDensity() const { return metalRegistry().get(impurity).density; }
+
+public:
+    GoldItem() : totalMassGrams(0), density(0), impurity(INVALID_METAL_ID) {}
+
+    void setImpurity(MetalId imp) { impurity = imp; }
+    void setTotalMass(double mass) { totalMassGrams = mass; }
+    void setDensity(double d) { density = d; }
+
+    void calculateDensityFromWeight(double weightInAirGrams, double weightInWaterGrams) {
+        if (weightInAirGrams > weightInWaterGrams && weightInWaterGrams > 0) {
+            density = weightInAirGrams / (weightInAirGrams - weightInWaterGrams);
+            totalMassGrams = weightInAirGrams;
+        }
+        else {
+            density = 0;
+        }
+    }
+
+    bool isDensityValid() const {
+        return metalRegistry().contains(impurity) && isDensityInRange(density, impurityDensity());
+    }
+
+    double getPureGoldMass() const {
+        if (!isDensityValid() || !(totalMassGrams > 0)) return 0.0; // a NaN mass too, as in the bulk kernel
+        if (std::abs(density - PURE_GOLD_DENSITY) < DENSITY_TOLERANCE) return totalMassGrams;
+        double objectVolume = totalMassGrams / density;
+        double volumeFractionGold = (density - impurityDensity()) / (PURE_GOLD_DENSITY - impurityDensity());
+        return (volumeFractionGold * objectVolume) * PURE_GOLD_DENSITY;
+    }
+
+    double getPurityPercentage() const {
+        double pureGoldMass = getPureGoldMass();
+        if (totalMassGrams <= 0 || pureGoldMass <= 0) return 0.0;
+        return (pureGoldMass / totalMassGrams) * 100.0;
+    }
+
+    double getKarats() const { return getPurityPercentage() * (24.0 / 100.0); }
+
+    // All three results through the assay cache: one lookup, and one computation on a miss.
+    PurityResult assay() const {
+        if (!metalRegistry().contains(impurity)) return { density, 0.0, 0.0, 0.0 };
+        return cachedAssay(totalMassGrams, density, impurityDensity());
+    }
+    double getDensity() const { return density; }
+    MetalId getImpurity() const { return impurity; }
+};
+
+// --- Bulk Purity Kernel ---
+// Structure-of-arrays version of GoldItem::getPureGoldMass / getPurityPercentage / getKarats.
+// Every lane evaluates all branches and selects with masks, so results are bit-identical to the
+// scalar GoldItem path. An impurity density <= 0 means "no impurity selected" (GoldItem's empty
+// Metal) and yields zeros.
+
+inline void computePurityScalar(size_t begin, size_t end, const double* massGrams, const double* density,
+    const double* impurityDensity, double* purityPercent, double* karats, double* pureGoldGrams) {
+    for (size_t i = begin; i < end; ++i) {
+        double m = massGrams[i], d = density[i], imp = impurityDensity[i];
+        double lowerBound = std::min(PURE_GOLD_DENSITY, imp);
+        double upperBound = std::max(PURE_GOLD_DENSITY, imp);
+        bool valid = d > 0 && imp > 0 && d >= lowerBound - DENSITY_TOLERANCE && d <= upperBound + DENSITY_TOLERANCE;
+
+        double pure = 0.0;
+        if (valid && m > 0) {
+            if (std::abs(d - PURE_GOLD_DENSITY) < DENSITY_TOLERANCE) pure = m;
+            else pure = (((d - imp) / (PURE_GOLD_DENSITY - imp)) * (m / d)) * PURE_GOLD_DENSITY;
+        }
+        double purity = (m <= 0 || pure <= 0) ? 0.0 : (pure / m) * 100.0;
+        pureGoldGrams[i] = pure;
+        purityPercent[i] = purity;
+        karats[i] = purity * (24.0 / 100.0);
+    }
+}
+
+// Fills purityPercent, karats and pureGoldGrams for count items in one pass.
+void computePurityBulk(size_t count, const double* massGrams, const double* density, const double* impurityDensity,
+    double* purityPercent, double* karats, double* pureGoldGrams);
+
+// Contiguous input/output columns for computePurityBulk.
+class AssayBatch {
+public:
+    std::vector<double> massGrams;
+    std::vector<double> density;
+    std::vector<double> impurityDensity;
+    std::vector<double> purityPercent;
+    std::vector<double> karats;
+    std::vector<double> pureGoldGrams;
+
+    void reserve(size_t n) {
+        for (auto* column : { &massGrams, &density, &impurityDensity, &purityPercent, &karats, &pureGoldGrams }) column->reserve(n);
+    }
+
+    void add(Mass<Grams> mass, double itemDensity, double impDensity) {
+        massGrams.push_back(mass.value());
+        density.push_back(itemDensity);
+        impurityDensity.push_back(impDensity);
+    }
+
+    size_t size() const { return massGrams.size(); }
+
+    void clear() {
+        for (auto* column : { &massGrams, &density, &impurityDensity, &purityPercent, &karats, &pureGoldGrams }) column->clear();
+    }
+
+    void compute() {
+        GOLDASH_TIMED_SCOPE(TimedOperation::BulkAssay);
+        purityPercent.resize(size());
+        karats.resize(size());
+        pureGoldGrams.resize(size());
+        computePurityBulk(size(), massGrams.data(), density.data(), impurityDensity.data(),
+            purityPercent.data(), karats.data(), pureGoldGrams.data());
+    }
+};
+
+// --- Hot-Path API ---
+// Single-item assays that neither allocate nor touch the registry, the cache or any stream, for
+// batch jobs, services and benchmarks. Results are bit-identical to GoldItem with the same
+// impurity density.
+
+PurityResult assayFromDensity(double massGrams, double density, double impurityDensity);
+PurityResult assayFromWeight(double weightInAirGrams, double weightInWaterGrams, double impurityDensity);
+
+// --- Karat Density Tables ---
+// Expected density of gold alloyed with a single impurity at each whole karat from 8K to 24K,
+// under the same no-volume-change mixing model that GoldItem inverts. The tables for the built-in
+// metals are generated at compile time; other metals get theirs in 17 divisions.
+
+constexpr int TABLE_MIN_KARAT = 8;
+constexpr int TABLE_MAX_KARAT = 24;
+constexpr size_t KARAT_TABLE_SIZE = TABLE_MAX_KARAT - TABLE_MIN_KARAT + 1;
+
+struct KaratDensityTable {
+    double density[KARAT_TABLE_SIZE]; // index karat - TABLE_MIN_KARAT; monotonic in karat
+
+    constexpr double at(int karat) const { return density[karat - TABLE_MIN_KARAT]; }
+};
+
+constexpr double karatDensity(double karat, double impurityDensity) {
+    double goldShare = karat / 24.0;
+    return 1.0 / (goldShare / PURE_GOLD_DENSITY + (1.0 - goldShare) / impurityDensity);
+}
+
+constexpr KaratDensityTable makeKaratDensityTable(double impurityDensity) {
+    KaratDensityTable table = {};
+    for (size_t i = 0; i < KARAT_TABLE_SIZE; ++i) table.density[i] = karatDensity(static_cast<double>(TABLE_MIN_KARAT + i), impurityDensity);
+    return table;
+}
+
+struct BuiltinKaratTables {
+    KaratDensityTable tables[BUILTIN_METAL_COUNT];
+    constexpr BuiltinKaratTables() : tables() {
+        for (size_t i = 0; i < BUILTIN_METAL_COUNT; ++i) tables[i] = makeKaratDensityTable(BUILTIN_METALS[i].density);
+    }
+};
+constexpr BuiltinKaratTables BUILTIN_KARAT_TABLES;
+
+static_assert(BUILTIN_KARAT_TABLES.tables[0].at(TABLE_MIN_KARAT) < BUILTIN_KARAT_TABLES.tables[0].at(TABLE_MAX_KARAT),
+    "gold alloyed with copper must get denser as the karat rises");
+
+// The built-in table when the metal still has its built-in density, otherwise a computed one.
+KaratDensityTable karatDensityTable(const Metal& impurity);
+
+// Whole karat whose expected density is closest to density, found by binary search; 0 if density
+// lies outside the 8K-24K range by more than DENSITY_TOLERANCE.
+int nearestTableKarat(const KaratDensityTable& table, double density);
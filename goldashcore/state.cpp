@@ -0,0 +1,129 @@
+#include "state.h"
+
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+class PackedStateReader {
+public:
+    PackedStateReader(const char* data, size_t size) : cursor(data), end(data + size) {}
+
+    template <typename T>
+    bool read(T& value) {
+        if (static_cast<size_t>(end - cursor) < sizeof(T)) return false;
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string& value) {
+        uint8_t length;
+        if (!read(length) || static_cast<size_t>(end - cursor) < length) return false;
+        value.assign(cursor, length);
+        cursor += length;
+        return true;
+    }
+
+    size_t remaining() const { return static_cast<size_t>(end - cursor); }
+
+private:
+    const char* cursor;
+    const char* end;
+};
+
+bool loadPackedState(const std::string& path, PackedState& state) {
+    GOLDASH_TIMED_SCOPE(TimedOperation::LoadState);
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(uint32_t)) return false;
+    size_t payloadSize = file.size() - sizeof(uint32_t);
+    uint32_t checksum;
+    std::memcpy(&checksum, file.data() + payloadSize, sizeof(checksum));
+    if (checksum != fnv1a(file.data(), payloadSize)) return false;
+    PackedStateReader reader(file.data(), payloadSize);
+
+    char magic[8];
+    uint32_t version, metalCount;
+    int32_t weightUnit;
+    uint8_t binaryLog;
+    if (!reader.read(magic) || std::memcmp(magic, STATE_MAGIC, sizeof(magic)) != 0) return false;
+    if (!reader.read(version) || version != STATE_VERSION) return false;
+    if (!reader.readString(state.settings.currencySymbol) || !reader.read(weightUnit) || !reader.read(binaryLog)) return false;
+    if (!reader.read(state.pricePerGram) || !reader.read(state.priceTimestamp) || !reader.read(metalCount)) return false;
+    if (weightUnit < 1 || weightUnit > 5) return false; // menu numbers, see withMassUnit
+    if (metalCount > reader.remaining() / (sizeof(uint8_t) + sizeof(double))) return false; // each metal is at least a length and a density
+    state.settings.defaultWeightUnit = weightUnit;
+    state.settings.binaryLog = binaryLog != 0;
+
+    state.metals.clear();
+    state.metals.reserve(metalCount);
+    for (uint32_t i = 0; i < metalCount; ++i) {
+        Metal metal;
+        if (!reader.readString(metal.name) || !reader.read(metal.density)) return false;
+        state.metals.push_back(metal);
+    }
+    return true;
+}
+
+template <typename T>
+void appendPacked(std::string& out, const T& value) { out.append(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+void appendPackedString(std::string& out, const std::string& value) {
+    uint8_t length = static_cast<uint8_t>(std::min<size_t>(value.size(), 255));
+    appendPacked(out, length);
+    out.append(value, 0, length);
+}
+
+bool savePackedState(const std::string& path, const PackedState& state) {
+    GOLDASH_TIMED_SCOPE(TimedOperation::SaveState);
+    std::string bytes(STATE_MAGIC, sizeof(STATE_MAGIC));
+    appendPacked(bytes, STATE_VERSION);
+    appendPackedString(bytes, state.settings.currencySymbol);
+    appendPacked(bytes, static_cast<int32_t>(state.settings.defaultWeightUnit));
+    appendPacked(bytes, static_cast<uint8_t>(state.settings.binaryLog ? 1 : 0));
+    appendPacked(bytes, state.pricePerGram);
+    appendPacked(bytes, state.priceTimestamp);
+    appendPacked(bytes, static_cast<uint32_t>(state.metals.size()));
+    for (const Metal& metal : state.metals) {
+        appendPackedString(bytes, metal.name);
+        appendPacked(bytes, metal.density);
+    }
+    appendPacked(bytes, fnv1a(bytes.data(), bytes.size()));
+    return writeFileAtomically(path, bytes);
+}
+
+uint32_t priceJournalChecksum(const PriceJournalRecord& record) {
+    return fnv1a(reinterpret_cast<const char*>(&record.pricePerGram), sizeof(record.pricePerGram) + sizeof(record.timestamp));
+}
+
+bool appendPriceJournal(const std::string& path, double pricePerGram, int64_t timestamp) {
+    PriceJournalRecord record = { PRICE_JOURNAL_MAGIC, 0, pricePerGram, timestamp };
+    record.checksum = priceJournalChecksum(record);
+    return appendDurably(path, std::string(reinterpret_cast<const char*>(&record), sizeof(record)));
+}
+
+// Scans back from the last whole record: a torn append leaves a partial or garbled tail.
+bool replayPriceJournal(const std::string& path, PackedState& state) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+    for (size_t offset = file.size() / sizeof(PriceJournalRecord) * sizeof(PriceJournalRecord); offset > 0;) {
+        offset -= sizeof(PriceJournalRecord);
+        PriceJournalRecord record;
+        std::memcpy(&record, file.data() + offset, sizeof(record));
+        if (record.magic != PRICE_JOURNAL_MAGIC || record.checksum != priceJournalChecksum(record)) continue;
+        if (record.timestamp >= state.priceTimestamp) {
+            state.pricePerGram = record.pricePerGram;
+            state.priceTimestamp = record.timestamp;
+        }
+        break;
+    }
+    return true;
+}
+
+bool clearPriceJournal(const std::string& path) {
+    std::error_code error;
+    if (!std::filesystem::exists(path, error)) return true;
+    std::filesystem::resize_file(path, 0, error);
+    return !error;
+}
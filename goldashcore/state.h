@@ -0,0 +1,89 @@
+#pragma once
+
+#include "durable_file.h"
+#include "instrumentation.h"
+#include "metals.h"
+#include "paths.h"
+
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// --- Settings ---
+
+class Settings {
+public:
+    std::string currencySymbol;
+    int defaultWeightUnit;
+    bool binaryLog; // also append fixed-width records to BINARY_LOG_FILENAME
+
+    Settings() : currencySymbol(""), defaultWeightUnit(1), binaryLog(false) {} // Default to grams
+
+    void load() {
+        GOLDASH_TIMED_SCOPE(TimedOperation::LoadSettings);
+        std::ifstream configFile(CONFIG_FILENAME);
+        if (configFile.is_open()) {
+            std::string line;
+            if (std::getline(configFile, line)) currencySymbol = line;
+            if (std::getline(configFile, line)) defaultWeightUnit = std::stoi(line);
+            if (std::getline(configFile, line)) binaryLog = (line == "1");
+        }
+    }
+
+    bool save() const {
+        std::ostringstream configFile;
+        configFile << currencySymbol << "\n";
+        configFile << defaultWeightUnit << "\n";
+        configFile << (binaryLog ? 1 : 0) << "\n";
+        return writeFileAtomically(CONFIG_FILENAME, configFile.str());
+    }
+};
+
+// --- Packed State File ---
+// Settings, metals and the latest price in one versioned file, read with a single mapping at
+// startup and ending in an fnv1a checksum of everything before it. Whenever it loads, it and the
+// price journal are authoritative: the individual files are not read, and the current price comes
+// from them rather than from the price history. Every save still writes the individual files; they
+// are read instead only when the packed file is missing or fails to load, and it is then rebuilt
+// from them.
+
+const char STATE_MAGIC[8] = { 'G', 'D', 'A', 'S', 'H', 'S', 'T', 'A' };
+const uint32_t STATE_VERSION = 2; // 2 added the checksum; older files fail to load and are rebuilt
+
+struct PackedState {
+    Settings settings;
+    std::vector<Metal> metals;
+    double pricePerGram = 0.0;
+    int64_t priceTimestamp = 0;
+};
+
+// False if the file is missing, torn, fails its checksum or holds out-of-range fields.
+bool loadPackedState(const std::string& path, PackedState& state);
+
+bool savePackedState(const std::string& path, const PackedState& state);
+
+// --- Price Journal ---
+// A price change would otherwise rewrite the whole packed state. Instead it is appended to the
+// journal as one checksummed 24-byte record. Loading applies the newest intact record that is not
+// older than the packed price; the caller then compacts by saving the packed state, which
+// empties the journal.
+
+const uint32_t PRICE_JOURNAL_MAGIC = 0x4A505047; // "GPPJ"
+
+struct PriceJournalRecord {
+    uint32_t magic;
+    uint32_t checksum; // fnv1a of pricePerGram and timestamp
+    double pricePerGram;
+    int64_t timestamp;
+};
+
+static_assert(sizeof(PriceJournalRecord) == 24, "price journal record layout changed");
+
+bool appendPriceJournal(const std::string& path, double pricePerGram, int64_t timestamp);
+
+// Applies the journal to state. Returns true if the journal holds anything, intact or not, and so needs compacting.
+bool replayPriceJournal(const std::string& path, PackedState& state);
+
+bool clearPriceJournal(const std::string& path);
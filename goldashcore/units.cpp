@@ -0,0 +1,13 @@
+#include "units.h"
+
+double massToGrams(int unit, double value) {
+    return withMassUnit(unit, [value](auto tag) { return Mass<Grams>(Mass<decltype(tag)>(value)).value(); });
+}
+
+int parseMassUnit(const std::string& symbol) {
+    const char* symbols[] = { Grams::SYMBOL, TroyOunces::SYMBOL, Ounces::SYMBOL, Pennyweights::SYMBOL, Tolas::SYMBOL };
+    for (int i = 0; i < 5; ++i) {
+        if (symbol == symbols[i]) return i + 1;
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+
+// --- Unit Conversion Constants ---
+constexpr double GRAMS_PER_TROY_OUNCE = 31.1034768;
+constexpr double GRAMS_PER_OUNCE = 28.3495;
+constexpr double GRAMS_PER_PENNYWEIGHT = 1.55517;
+constexpr double GRAMS_PER_TOLA = 11.6638;
+constexpr double GRAMS_PER_CARAT = 0.2;
+
+// --- Mass Units ---
+// Each unit is a tag type carrying its gram factor. A Mass<Unit> converts to another unit with a
+// single multiply folded at compile time, and cannot be mixed up with a bare double.
+
+struct Grams { static constexpr double GRAMS_PER_UNIT = 1.0; static constexpr const char* SYMBOL = "g"; };
+struct TroyOunces { static constexpr double GRAMS_PER_UNIT = GRAMS_PER_TROY_OUNCE; static constexpr const char* SYMBOL = "ozt"; };
+struct Ounces { static constexpr double GRAMS_PER_UNIT = GRAMS_PER_OUNCE; static constexpr const char* SYMBOL = "oz"; };
+struct Pennyweights { static constexpr double GRAMS_PER_UNIT = GRAMS_PER_PENNYWEIGHT; static constexpr const char* SYMBOL = "dwt"; };
+struct Tolas { static constexpr double GRAMS_PER_UNIT = GRAMS_PER_TOLA; static constexpr const char* SYMBOL = "tola"; };
+struct Carats { static constexpr double GRAMS_PER_UNIT = GRAMS_PER_CARAT; static constexpr const char* SYMBOL = "ct"; };
+
+template <typename Unit>
+class Mass {
+public:
+    constexpr explicit Mass(double quantity = 0.0) : amount(quantity) {}
+
+    template <typename Other>
+    constexpr Mass(Mass<Other> other) : amount(other.value() * (Other::GRAMS_PER_UNIT / Unit::GRAMS_PER_UNIT)) {}
+
+    constexpr double value() const { return amount; }
+
+    constexpr Mass operator+(Mass other) const { return Mass(amount + other.amount); }
+    constexpr Mass operator-(Mass other) const { return Mass(amount - other.amount); }
+    constexpr Mass operator*(double factor) const { return Mass(amount * factor); }
+
+private:
+    double amount;
+};
+
+static_assert(Mass<Grams>(Mass<TroyOunces>(1.0)).value() == GRAMS_PER_TROY_OUNCE, "troy ounce factor");
+static_assert(Mass<Carats>(Mass<Grams>(1.0)).value() == 5.0, "carats per gram");
+
+// Weight units by their menu number (1 g, 2 ozt, 3 oz, 4 dwt, 5 tola), as stored in Settings.
+// This is the only runtime branch on the unit: the body is instantiated once per unit type.
+template <typename Body>
+auto withMassUnit(int unit, Body&& body) -> decltype(body(Grams())) {
+    switch (unit) {
+    case 2: return body(TroyOunces());
+    case 3: return body(Ounces());
+    case 4: return body(Pennyweights());
+    case 5: return body(Tolas());
+    default: return body(Grams());
+    }
+}
+
+// Converts a value in the given menu unit to grams.
+double massToGrams(int unit, double value);
+
+// Menu number for a unit symbol ("g", "ozt", "oz", "dwt", "tola"), or 0 if unknown.
+int parseMassUnit(const std::string& symbol);
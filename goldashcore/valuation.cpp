@@ -0,0 +1,139 @@
+#include "valuation.h"
+
+#include "units.h"
+
+#include <algorithm>
+#include <charconv>
+
+std::vector<double> dailyLogReturns(const std::vector<double>& prices) {
+    std::vector<double> returns;
+    for (size_t i = 1; i < prices.size(); ++i) {
+        if (prices[i - 1] > 0 && prices[i] > 0) returns.push_back(std::log(prices[i] / prices[i - 1]));
+    }
+    return returns;
+}
+
+std::vector<double> priceLadder(double low, double high, size_t count) {
+    std::vector<double> prices(count, low);
+    for (size_t i = 1; i < count; ++i) prices[i] = low + (high - low) * static_cast<double>(i) / static_cast<double>(count - 1);
+    return prices;
+}
+
+SweepGrid sweepPriceKaratGrid(const Portfolio& portfolio, const std::vector<double>& pricesPerGram, const std::vector<int>& karats) {
+    const size_t BLOCK_CELLS = 8192; // 64 KB of output per block
+    SweepGrid grid;
+    grid.pricesPerGram = pricesPerGram;
+    grid.karats = karats;
+    size_t holdings = portfolio.holdings.size();
+    grid.columns = holdings + 1;
+    size_t rowCount = pricesPerGram.size() * karats.size();
+    grid.values.resize(rowCount * grid.columns);
+
+    std::vector<double> mass(holdings);
+    for (size_t h = 0; h < holdings; ++h) mass[h] = portfolio.holdings[h].massGrams;
+    parallelForChunks(rowCount, std::max<size_t>(1, BLOCK_CELLS / grid.columns), [&](size_t, size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+            double pricePerGramGold = pricesPerGram[r / karats.size()] * (karats[r % karats.size()] / 24.0);
+            Money* row = &grid.values[r * grid.columns];
+            Money total;
+            for (size_t h = 0; h < holdings; ++h) {
+                row[h] = Money::fromDouble(mass[h] * pricePerGramGold);
+                total += row[h];
+            }
+            row[holdings] = total;
+        }
+    });
+    return grid;
+}
+
+void writeSweepCsv(std::ostream& out, const Portfolio& portfolio, const SweepGrid& grid, const std::vector<int>& units) {
+    out << "Unit,PricePerUnit,Karat";
+    for (const Holding& holding : portfolio.holdings) out << "," << holding.tag;
+    out << ",Total\n";
+    // to_chars and Money::format rather than the stream or printf: formatting is most of the time spent here.
+    std::string buffer;
+    char number[64];
+    auto appendPrice = [&](double price) {
+        buffer += ',';
+        char* end = std::to_chars(number, number + sizeof(number), price, std::chars_format::fixed, 2).ptr;
+        buffer.append(number, static_cast<size_t>(end - number));
+    };
+    auto appendMoney = [&](Money value) {
+        buffer += ',';
+        buffer.append(number, value.format(number));
+    };
+    for (int unit : units) {
+        const char* symbol = withMassUnit(unit, [](auto tag) { return decltype(tag)::SYMBOL; });
+        double gramsPerUnit = withMassUnit(unit, [](auto tag) { return decltype(tag)::GRAMS_PER_UNIT; });
+        for (size_t p = 0; p < grid.pricesPerGram.size(); ++p) {
+            for (size_t k = 0; k < grid.karats.size(); ++k) {
+                buffer += symbol;
+                appendPrice(grid.pricesPerGram[p] * gramsPerUnit);
+                buffer += ',';
+                buffer += std::to_string(grid.karats[k]);
+                const Money* row = grid.row(p, k);
+                for (size_t c = 0; c < grid.columns; ++c) appendMoney(row[c]);
+                buffer += '\n';
+                if (buffer.size() >= 1 << 16) {
+                    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                    buffer.clear();
+                }
+            }
+        }
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+ScenarioResult simulatePriceScenarios(const ScenarioConfig& config, double startPrice, double totalPureGold) {
+    const size_t CHUNK_SIZE = 65536;
+    std::vector<double> values(config.paths);
+    double years = config.horizonDays / 365.0;
+    double gbmDrift = (config.annualDrift - 0.5 * config.annualVolatility * config.annualVolatility) * years;
+    double gbmScale = config.annualVolatility * std::sqrt(years);
+    const std::vector<double>& returns = config.dailyLogReturns;
+
+    parallelForChunks(config.paths, CHUNK_SIZE, [&](size_t, size_t begin, size_t end) {
+        for (size_t path = begin; path < end; ++path) {
+            CounterRng rng(config.seed, path);
+            double logGrowth = 0.0;
+            if (config.model == ScenarioModel::GeometricBrownian) {
+                logGrowth = gbmDrift + gbmScale * rng.normal(); // exact terminal draw, no stepping needed
+            }
+            else {
+                for (int day = 0; day < config.horizonDays; ++day) logGrowth += returns[rng.index(returns.size())];
+            }
+            values[path] = totalPureGold * startPrice * std::exp(logGrowth);
+        }
+    });
+
+    ScenarioResult result;
+    if (values.empty()) return result;
+    double currentValue = totalPureGold * startPrice;
+    size_t chunkCount = (values.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    std::vector<double> chunkSums(chunkCount, 0.0);
+    std::vector<size_t> chunkLosses(chunkCount, 0);
+    parallelForChunks(values.size(), CHUNK_SIZE, [&](size_t chunk, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            chunkSums[chunk] += values[i];
+            if (values[i] < currentValue) ++chunkLosses[chunk];
+        }
+    });
+    size_t losses = 0;
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        result.meanValue += chunkSums[chunk];
+        losses += chunkLosses[chunk];
+    }
+    result.meanValue /= static_cast<double>(values.size());
+    result.probabilityOfLoss = static_cast<double>(losses) / static_cast<double>(values.size());
+
+    // Ascending percentiles let each nth_element work on the still-unordered tail only.
+    result.percentileLevels = { 1, 5, 25, 50, 75, 95, 99 };
+    auto first = values.begin();
+    for (int level : result.percentileLevels) {
+        auto nth = values.begin() + static_cast<std::ptrdiff_t>((level / 100.0) * static_cast<double>(values.size() - 1));
+        std::nth_element(first, nth, values.end());
+        result.percentileValues.push_back(*nth);
+        first = nth;
+    }
+    return result;
+}
@@ -0,0 +1,234 @@
+#pragma once
+
+#include "durable_file.h"
+#include "money.h"
+#include "parallel.h"
+#include "price.h"
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// --- Portfolio ---
+
+class Holding {
+public:
+    double massGrams;
+    double karat;
+    int64_t acquiredAt; // unix time the holding was added; 0 if unknown
+    std::string tag;
+    Holding(double m = 0.0, double k = 0.0, std::string t = "", int64_t acquired = 0)
+        : massGrams(m), karat(k), acquiredAt(acquired), tag(t) {}
+    double getPureGoldMass() const { return massGrams * (karat / 24.0); }
+};
+
+// Persistent list of holdings, one "mass karat [@acquiredAt] tag" line per holding.
+class Portfolio {
+public:
+    std::vector<Holding> holdings;
+
+    void load(const std::string& path) {
+        holdings.clear();
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream fields(line);
+            Holding holding;
+            if (!(fields >> holding.massGrams >> holding.karat)) continue;
+            if ((fields >> std::ws).peek() == '@') {
+                fields.get();
+                fields >> holding.acquiredAt;
+            }
+            std::getline(fields >> std::ws, holding.tag);
+            holdings.push_back(holding);
+        }
+    }
+
+    bool save(const std::string& path) const {
+        std::ostringstream file;
+        file << std::setprecision(17);
+        for (const Holding& holding : holdings) {
+            file << holding.massGrams << " " << holding.karat << " ";
+            if (holding.acquiredAt > 0) file << "@" << holding.acquiredAt << " ";
+            file << holding.tag << "\n";
+        }
+        return writeFileAtomically(path, file.str());
+    }
+};
+
+// --- Revaluation Engine ---
+// Re-prices a whole portfolio against many candidate prices in one pass over the holdings.
+// Aggregates are reduced from fixed-size chunks, so totals do not depend on the thread count.
+// Each holding's value is rounded to cents and the totals are exact sums of those, so they
+// match the per-holding report to the cent.
+
+struct RevaluationResult {
+    std::vector<double> prices;
+    std::vector<Money> totalValue;    // per candidate price
+    std::vector<Money> totalProfit;   // per candidate price, relative to the current price
+    double totalPureGold = 0.0;
+    Money currentValue;
+    Money totalCostBasis;             // pure gold valued at the price in effect when each holding was acquired
+    size_t holdingsWithoutCost = 0;   // acquisition time unknown or before the first recorded price
+};
+
+class RevaluationEngine {
+public:
+    static const size_t CHUNK_SIZE = 16384;
+
+    // With a price history, each holding's cost basis is its pure gold at the price in effect when it was acquired.
+    explicit RevaluationEngine(const Portfolio& portfolio, const PriceHistory* history = nullptr)
+        : portfolio(portfolio), pureGold(portfolio.holdings.size()), costPrice(portfolio.holdings.size(), 0.0) {
+        parallelForChunks(pureGold.size(), CHUNK_SIZE, [&](size_t, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const Holding& holding = portfolio.holdings[i];
+                pureGold[i] = holding.getPureGoldMass();
+                if (history != nullptr && holding.acquiredAt > 0) costPrice[i] = history->priceAt(holding.acquiredAt);
+            }
+        });
+    }
+
+    RevaluationResult revalue(const std::vector<double>& prices, double currentPrice) const {
+        size_t priceCount = prices.size();
+        size_t chunkCount = (pureGold.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        // Per chunk: [value at the current price, cost basis, value at price 0, value at price 1, ...].
+        const size_t STRIDE = priceCount + 2;
+        std::vector<Money> partials(chunkCount * STRIDE);
+        std::vector<double> partialGold(chunkCount, 0.0);
+        std::vector<size_t> partialWithoutCost(chunkCount, 0);
+        parallelForChunks(pureGold.size(), CHUNK_SIZE, [&](size_t chunk, size_t begin, size_t end) {
+            Money* partial = &partials[chunk * STRIDE];
+            for (size_t i = begin; i < end; ++i) {
+                double grams = pureGold[i];
+                partialGold[chunk] += grams;
+                partial[0] += Money::fromDouble(grams * currentPrice);
+                if (costPrice[i] > 0) partial[1] += Money::fromDouble(grams * costPrice[i]);
+                else ++partialWithoutCost[chunk];
+                for (size_t p = 0; p < priceCount; ++p) partial[p + 2] += Money::fromDouble(grams * prices[p]);
+            }
+        });
+
+        RevaluationResult result;
+        result.prices = prices;
+        result.totalValue.assign(priceCount, Money());
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+            const Money* partial = &partials[chunk * STRIDE];
+            result.totalPureGold += partialGold[chunk];
+            result.holdingsWithoutCost += partialWithoutCost[chunk];
+            result.currentValue += partial[0];
+            result.totalCostBasis += partial[1];
+            for (size_t p = 0; p < priceCount; ++p) result.totalValue[p] += partial[p + 2];
+        }
+        result.totalProfit.resize(priceCount);
+        for (size_t p = 0; p < priceCount; ++p) result.totalProfit[p] = result.totalValue[p] - result.currentValue;
+        return result;
+    }
+
+    Money holdingValue(size_t index, double price) const { return Money::fromDouble(pureGold[index] * price); }
+    Money holdingProfit(size_t index, double price, double currentPrice) const {
+        return holdingValue(index, price) - holdingValue(index, currentPrice);
+    }
+
+    // One CSV row per holding with its value and P/L at every candidate price.
+    void writeHoldingReport(std::ostream& out, const std::vector<double>& prices, double currentPrice) const {
+        out << "Tag,Mass(g),Karat,PureGold(g),CostBasis";
+        for (double price : prices) out << ",Value@" << price << ",PL@" << price;
+        out << "\n" << std::fixed << std::setprecision(2);
+        for (size_t i = 0; i < pureGold.size(); ++i) {
+            const Holding& holding = portfolio.holdings[i];
+            out << holding.tag << "," << holding.massGrams << "," << holding.karat << "," << pureGold[i] << ","
+                << Money::fromDouble(pureGold[i] * costPrice[i]);
+            for (double price : prices) out << "," << holdingValue(i, price) << "," << holdingProfit(i, price, currentPrice);
+            out << "\n";
+        }
+    }
+
+private:
+    const Portfolio& portfolio;
+    std::vector<double> pureGold;
+    std::vector<double> costPrice;
+};
+
+// --- Price x Karat Sweep ---
+// Values every holding, and the portfolio total, as if it assayed at each karat level while gold
+// trades at each candidate price: the negotiation table for a lot. Grid rows are (price, karat)
+// pairs filled in parallel in blocks of rows, so each block writes one contiguous stretch of the
+// grid with the holdings' masses staying in cache. Weight units only change how prices are quoted
+// in the output; values are the same in every unit.
+
+struct SweepGrid {
+    std::vector<double> pricesPerGram;
+    std::vector<int> karats;
+    size_t columns = 0;        // one per holding, then the total
+    std::vector<Money> values; // [price][karat][column]
+
+    const Money* row(size_t price, size_t karat) const { return &values[(price * karats.size() + karat) * columns]; }
+};
+
+// count evenly spaced prices from low to high inclusive.
+std::vector<double> priceLadder(double low, double high, size_t count);
+
+SweepGrid sweepPriceKaratGrid(const Portfolio& portfolio, const std::vector<double>& pricesPerGram, const std::vector<int>& karats);
+
+// One row per weight unit (menu number), price and karat: the price per unit, every holding's
+// value and the total.
+void writeSweepCsv(std::ostream& out, const Portfolio& portfolio, const SweepGrid& grid, const std::vector<int>& units);
+
+// --- Monte Carlo Price Scenarios ---
+// Every path draws from its own counter-based stream keyed on (seed, path, draw), so a given seed
+// reproduces the same distribution on any number of threads.
+
+class CounterRng {
+public:
+    CounterRng(uint64_t seed, uint64_t stream) : key(mix(seed ^ mix(stream + 0x9E3779B97F4A7C15ULL))), counter(0) {}
+
+    double uniform() { return (static_cast<double>(mix(key + counter++ * 0x9E3779B97F4A7C15ULL) >> 11) + 0.5) * 0x1.0p-53; }
+
+    double normal() {
+        const double TWO_PI = 6.283185307179586;
+        double radius = std::sqrt(-2.0 * std::log(uniform()));
+        return radius * std::cos(TWO_PI * uniform());
+    }
+
+    size_t index(size_t bound) { return static_cast<size_t>(uniform() * static_cast<double>(bound)) % bound; }
+
+private:
+    uint64_t key;
+    uint64_t counter;
+
+    // SplitMix64 finalizer.
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+};
+
+enum class ScenarioModel { GeometricBrownian, Bootstrap };
+
+struct ScenarioConfig {
+    ScenarioModel model = ScenarioModel::GeometricBrownian;
+    size_t paths = 1000000;
+    int horizonDays = 30;
+    double annualDrift = 0.0;       // GBM only, e.g. 0.05 for 5% a year
+    double annualVolatility = 0.15; // GBM only
+    uint64_t seed = 1;
+    std::vector<double> dailyLogReturns; // Bootstrap only
+};
+
+struct ScenarioResult {
+    std::vector<int> percentileLevels; // whole percents
+    std::vector<double> percentileValues;
+    double meanValue = 0.0;
+    double probabilityOfLoss = 0.0;
+};
+
+// Daily log returns between consecutive prices, for bootstrapping.
+std::vector<double> dailyLogReturns(const std::vector<double>& prices);
+
+// Simulates config.paths terminal prices and summarises the portfolio value distribution.
+ScenarioResult simulatePriceScenarios(const ScenarioConfig& config, double startPrice, double totalPureGold);